@@ -9,5 +9,10 @@
 
 #include "matt_chordial_synth.h"
 
+#include "synth/ChordialThreadPool.cpp"
 #include "synth/ChordialVoice.cpp"
-#include "synth/ChordialSynthesiser.cpp"
\ No newline at end of file
+#include "synth/ChordialSynthesiser.cpp"
+
+#if CHORDIAL_TOOLS
+ #include "synth/ChordialOfflineRenderer.cpp"
+#endif
\ No newline at end of file
@@ -7,7 +7,7 @@
   name:             Chordial2 Synth classes
   description:      Chordial Synth classes
 
-  dependencies:     juce_audio_basics, juce_audio_processors, juce_core, juce_dsp
+  dependencies:     juce_audio_basics, juce_audio_formats, juce_audio_processors, juce_core, juce_dsp
 
  END_JUCE_MODULE_DECLARATION
 
@@ -17,7 +17,45 @@
 #pragma once
 #define MATT_CHORDIAL_H_INCLUDED
 
+//==============================================================================
+/** Config: CHORDIAL_PERF_COUNTERS
+    Records per-block timings of the control tick and voice stages, voice starts and steals
+    and active voice counts, for ChordialSynthesiser::getPerformanceStats(). Off by default,
+    when the recording compiles to nothing.
+*/
+#ifndef CHORDIAL_PERF_COUNTERS
+ #define CHORDIAL_PERF_COUNTERS 0
+#endif
+
+/** Config: CHORDIAL_TRACE
+    Records begin/end spans and instants of the audio thread's and render workers' activity,
+    which ChordialSynthesiser::startTracing() writes out as a Chrome trace event file. Off by
+    default, when the recording compiles to nothing.
+*/
+#ifndef CHORDIAL_TRACE
+ #define CHORDIAL_TRACE 0
+#endif
+
+/** Config: CHORDIAL_FAST_MATH
+    Computes oscillator detune and frequency modulation, filter cutoff modulation and
+    keytracking, and note frequencies with the approximations and tables in ChordialFastMath.h
+    instead of std::pow: 1 keeps pitch within 1 cent, 2 within 0.1 cent. Off (0) by default.
+*/
+#ifndef CHORDIAL_FAST_MATH
+ #define CHORDIAL_FAST_MATH 0
+#endif
+
+/** Config: CHORDIAL_TOOLS
+    Compiles ChordialOfflineRenderer and the ChordialBenchmark and ChordialLoadTest harnesses
+    built on it, for the command line tools in tools/. Off by default, so plugins using the
+    module do not build them.
+*/
+#ifndef CHORDIAL_TOOLS
+ #define CHORDIAL_TOOLS 0
+#endif
+
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
 #include <juce_dsp/juce_dsp.h>
@@ -28,10 +66,30 @@
 
 #include "synth/Utilities.h"
 #include "synth/ChordialModule.h"
+#include "synth/ChordialThreadPool.h"
+#include "synth/ChordialParameters.h"
+#include "synth/ChordialPerfCounters.h"
+#include "synth/ChordialTrace.h"
+#include "synth/ChordialSIMD.h"
+#include "synth/ChordialFastMath.h"
+#include "synth/ChordialPhaseAccumulator.h"
+#include "synth/ChordialWavetable.h"
+#include "synth/ChordialModMatrix.h"
 #include "synth/ChordialOscillator.h"
+#include "synth/ChordialOscillatorBank.h"
+#include "synth/ChordialUnisonOscillator.h"
+#include "synth/ChordialOversampling.h"
+#include "synth/ChordialLadderFilter.h"
 #include "synth/ChordialFilter.h"
+#include "synth/ChordialFilterBank.h"
 #include "synth/ChordialDCA.h"
 #include "synth/ChordialEnvelope.h"
-#include "synth/ChordialModMatrix.h"
+#include "synth/ChordialVoiceManager.h"
 #include "synth/ChordialVoice.h"
 #include "synth/ChordialSynthesiser.h"
+
+#if CHORDIAL_TOOLS
+ #include "synth/ChordialOfflineRenderer.h"
+ #include "synth/ChordialBenchmark.h"
+ #include "synth/ChordialLoadTest.h"
+#endif
@@ -0,0 +1,589 @@
+/*
+  ==============================================================================
+
+    ChordialBenchmark.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Throughput measurements for the synth modules. Not for use on the audio thread.
+
+    Case names are module/variant.../sampleRate/blockSize, and samples are sample frames
+    of the unit under test (one voice, one envelope, ..., or the whole synth's output),
+    so nanoseconds per sample compare across runs of the same case. toJSON() writes the
+    results with enough about the build and machine to track them over time.
+*/
+class ChordialBenchmark
+{
+public:
+    struct Result
+    {
+        std::string name;
+        double samplesPerSecond;
+
+        double getNanosecondsPerSample() const { return samplesPerSecond > 0.0 ? 1.0e9 / samplesPerSecond : 0.0; }
+    };
+
+    struct Options
+    {
+        std::vector<double> sampleRates{ 44100.0, 96000.0 };
+        std::vector<size_t> blockSizes{ 32, 128, 512 };
+        std::vector<int> matrixRowCounts{ 1, 4, 16, 64 };
+        std::vector<int> voiceCounts{ 1, 4, 16, 64, 256 };
+        double minimumSeconds{ 0.25 };
+        // Only cases whose name contains this run, empty runs everything
+        std::string filter;
+    };
+
+    // Calls render repeatedly for at least minimumSeconds; each call must produce samplesPerCall samples
+    template <typename RenderFunction>
+    static Result measure(const std::string& name, size_t samplesPerCall, RenderFunction&& render, double minimumSeconds = 0.25)
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        render(); // warm up caches and smoothing
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        auto elapsed = 0.0;
+        size_t samples = 0;
+
+        do
+        {
+            render();
+            samples += samplesPerCall;
+            elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        } while (elapsed < minimumSeconds);
+
+        return { name, static_cast<double>(samples) / elapsed };
+    }
+
+    // Every suite at every sample rate and block size in options
+    static std::vector<Result> runAll(const Options& options)
+    {
+        std::vector<Result> results;
+        auto append = [&results](std::vector<Result> suite)
+        {
+            results.insert(results.end(), suite.begin(), suite.end());
+        };
+
+        for (const auto sampleRate : options.sampleRates)
+        {
+            for (const auto blockSize : options.blockSizes)
+            {
+                append(runOscillatorThroughput(sampleRate, blockSize, options));
+                append(runUnisonThroughput(sampleRate, blockSize, options));
+                append(runFilterThroughput(sampleRate, blockSize, options));
+                append(runEnvelopeThroughput(sampleRate, blockSize, options));
+                append(runDCAThroughput(sampleRate, blockSize, options));
+                append(runModMatrixThroughput(sampleRate, blockSize, options));
+            }
+
+            // Whole voices and synths are always fed host sized blocks
+            append(runVoiceScaling(sampleRate, 512, options));
+            append(runSynthScaling(sampleRate, 512, options));
+            append(runSchedulingComparison(sampleRate, 512, options));
+        }
+
+        return results;
+    }
+
+    // Per-sample processSample() loop ("sample") against processBlock() ("block") for each waveform
+    static std::vector<Result> runOscillatorThroughput(double sampleRate, size_t blockSize, const Options& options)
+    {
+        using Waveform = ChordialOscillatorMaster<float>::Waveform;
+        const std::pair<Waveform, std::string> waveforms[] = {
+            { Waveform::saw, "saw" }, { Waveform::square, "square" }, { Waveform::triangle, "triangle" },
+            { Waveform::wavetable, "wavetable" }
+        };
+
+        std::vector<Result> results;
+        std::vector<float> buffer(blockSize);
+        volatile float sink = 0.0f;
+
+        for (const auto& waveform : waveforms)
+        {
+            for (auto antialiased : { false, true })
+            {
+                auto master = std::make_shared<ChordialOscillatorMaster<float>>();
+                master->setWaveform(waveform.first);
+                master->setAntialiasing(antialiased);
+
+                ChordialOscillatorVoice<float> oscillator;
+                oscillator.setMasterOscillator(master);
+                oscillator.prepare({ sampleRate, static_cast<juce::uint32>(blockSize), 1 });
+                oscillator.setBaseFrequency(440.0f);
+
+                const auto caseName = "oscillator/" + waveform.second + (antialiased ? "/aa" : "/noaa");
+
+                run(results, options, getCaseName(caseName + "/sample", sampleRate, blockSize), blockSize, [&]
+                {
+                    for (size_t i = 0; i < blockSize; ++i)
+                        buffer[i] = oscillator.processSample();
+                    sink = sink + buffer[blockSize - 1];
+                });
+
+                run(results, options, getCaseName(caseName + "/block", sampleRate, blockSize), blockSize, [&]
+                {
+                    oscillator.processBlock(buffer.data(), blockSize);
+                    sink = sink + buffer[blockSize - 1];
+                });
+            }
+        }
+
+        return results;
+    }
+
+    // Stereo filter voice per engine; the native engine at fixed 4x and adaptive oversampling
+    static std::vector<Result> runFilterThroughput(double sampleRate, size_t blockSize, const Options& options)
+    {
+        using Engine = ChordialFilterMaster<float>::Engine;
+        struct Variant { Engine engine; bool adaptive; std::string name; };
+        const Variant variants[] = {
+            { Engine::juceLadder, false, "juce" },
+            { Engine::chordialLadder, false, "chordial/4x" },
+            { Engine::chordialLadder, true, "chordial/adaptive" }
+        };
+
+        std::vector<Result> results;
+        const auto input = makeNoise(2, blockSize);
+        juce::AudioBuffer<float> buffer(2, static_cast<int>(blockSize));
+
+        for (const auto& variant : variants)
+        {
+            auto master = std::make_shared<ChordialFilterMaster<float>>();
+            master->setEngine(variant.engine);
+            master->setOversamplingFactor(2);
+            master->setAdaptiveOversampling(variant.adaptive);
+            master->setCutoff(2000.0f);
+            master->setResonance(0.3f);
+
+            ChordialFilterVoice<float> filter;
+            filter.setMasterFilter(master);
+            filter.prepare({ sampleRate, static_cast<juce::uint32>(blockSize), 2 });
+            filter.setNoteNumber(60);
+
+            run(results, options, getCaseName("filter/" + variant.name, sampleRate, blockSize), blockSize, [&]
+            {
+                copyBuffer(input, buffer);
+                juce::dsp::AudioBlock<float> block(buffer);
+                filter.process(juce::dsp::ProcessContextReplacing<float>(block));
+            });
+        }
+
+        return results;
+    }
+
+    // One envelope stepped at the default control rate, and rendered at audio rate
+    static std::vector<Result> runEnvelopeThroughput(double sampleRate, size_t blockSize, const Options& options)
+    {
+        constexpr int controlRate = 100;
+
+        ChordialMasterADSR<float, float> master;
+        master.setSampleRate(sampleRate, controlRate);
+        master.setAttackTimeMs(5.0f);
+        master.setDecayTimeMs(50.0f);
+        master.setSustainValue(0.5f);
+        master.setReleaseTimeMs(100.0f);
+
+        std::vector<Result> results;
+        std::vector<float> buffer(blockSize);
+        volatile float sink = 0.0f;
+
+        // Re-gated every 0.2 s so every segment is visited
+        const auto samplesPerNote = static_cast<size_t>(sampleRate * 0.2);
+
+        ChordialVoiceADSR<float, float> controlEnvelope(master);
+        size_t controlPosition = 0, controlCountdown = 0;
+        run(results, options, getCaseName("envelope/control", sampleRate, blockSize), blockSize, [&]
+        {
+            regate(controlEnvelope, controlPosition, blockSize, samplesPerNote);
+            for (size_t remaining = blockSize; remaining > 0;)
+            {
+                if (controlCountdown == 0)
+                {
+                    sink = sink + controlEnvelope.getNextValue();
+                    controlCountdown = controlRate;
+                }
+                const auto step = juce::jmin(remaining, controlCountdown);
+                controlCountdown -= step;
+                remaining -= step;
+            }
+        });
+
+        ChordialVoiceADSR<float, float> audioEnvelope(master);
+        size_t audioPosition = 0;
+        run(results, options, getCaseName("envelope/audio", sampleRate, blockSize), blockSize, [&]
+        {
+            regate(audioEnvelope, audioPosition, blockSize, samplesPerNote);
+            audioEnvelope.processBlock(buffer.data(), blockSize);
+            sink = sink + buffer[blockSize - 1];
+        });
+
+        return results;
+    }
+
+    // Stereo antialiased saw unison stacks of 1 to 16 copies. Samples per second count output
+    // samples, so copies times rate gives the per-copy throughput.
+    static std::vector<Result> runUnisonThroughput(double sampleRate, size_t blockSize, const Options& options)
+    {
+        std::vector<Result> results;
+        juce::AudioBuffer<float> buffer(2, static_cast<int>(blockSize));
+
+        auto master = std::make_shared<ChordialOscillatorMaster<float>>();
+        master->setWaveform(ChordialOscillatorMaster<float>::Waveform::saw);
+        master->setDetuneAmount(0.01f);
+
+        for (auto numVoices : { 1, 2, 4, 8, 16 })
+        {
+            ChordialUnisonOscillator<float> unison;
+            unison.setMasterOscillator(master);
+            unison.setNumVoices(numVoices);
+            unison.prepare({ sampleRate, static_cast<juce::uint32>(blockSize), 2 });
+            unison.setBaseFrequency(440.0f);
+
+            run(results, options, getCaseName("unison/" + std::to_string(numVoices), sampleRate, blockSize), blockSize, [&]
+            {
+                buffer.clear();
+                juce::dsp::AudioBlock<float> block(buffer);
+                unison.process(juce::dsp::ProcessContextReplacing<float>(block));
+            });
+        }
+
+        return results;
+    }
+
+    // Stereo DCA with its control rate gain ramp, and with an audio rate gain signal, in place
+    // and fused with adding to an output buffer as ChordialVoice uses it
+    static std::vector<Result> runDCAThroughput(double sampleRate, size_t blockSize, const Options& options)
+    {
+        std::vector<Result> results;
+        const auto input = makeNoise(2, blockSize);
+        juce::AudioBuffer<float> buffer(2, static_cast<int>(blockSize));
+        juce::AudioBuffer<float> mix(2, static_cast<int>(blockSize));
+        mix.clear();
+
+        for (auto audioRate : { false, true })
+        {
+            ChordialDCAVoice<float> dca;
+            dca.prepare({ sampleRate, static_cast<juce::uint32>(blockSize), 2 });
+            dca.setSamplesPerControlSignal(100);
+            dca.setVoiceGain(0.8f);
+
+            auto* gainBuffer = dca.getGainModInputBuffer();
+            juce::FloatVectorOperations::fill(gainBuffer->data.get(), 0.5f, static_cast<int>(blockSize));
+            gainBuffer->active = audioRate;
+
+            auto toggle = false;
+            run(results, options, getCaseName(audioRate ? "dca/audio" : "dca/ramp", sampleRate, blockSize), blockSize, [&]
+            {
+                // Keeps the ramp moving
+                toggle = !toggle;
+                *dca.getGainModInputPtr() = toggle ? 0.25f : 0.75f;
+
+                copyBuffer(input, buffer);
+                juce::dsp::AudioBlock<float> block(buffer);
+                dca.process(juce::dsp::ProcessContextReplacing<float>(block));
+            });
+
+            // The source is left as it is, so one copy does
+            copyBuffer(input, buffer);
+            run(results, options, getCaseName(audioRate ? "dca/audio/mix" : "dca/ramp/mix", sampleRate, blockSize), blockSize, [&]
+            {
+                toggle = !toggle;
+                *dca.getGainModInputPtr() = toggle ? 0.25f : 0.75f;
+
+                dca.processAndAdd(juce::dsp::AudioBlock<float>(buffer), juce::dsp::AudioBlock<float>(mix));
+            });
+        }
+
+        return results;
+    }
+
+    // numRows rows spread over 8 sources and 8 destinations, at control and at audio rate.
+    // Each call is one control tick plus blockSize samples of audio rate routing.
+    static std::vector<Result> runModMatrixThroughput(double sampleRate, size_t blockSize, const Options& options)
+    {
+        constexpr int numSources = 8, numDestinations = 8;
+
+        std::vector<Result> results;
+
+        for (const auto numRows : options.matrixRowCounts)
+        {
+            for (auto audioRate : { false, true })
+            {
+                auto core = std::make_shared<ChordialModMatrixCore>();
+                ChordialModMatrix<float> matrix;
+                matrix.setCore(core);
+
+                std::vector<float> sources(numSources, 0.5f), destinations(numDestinations);
+                std::vector<ChordialModulationBuffer<float>> destinationBuffers(numDestinations);
+
+                for (int i = 0; i < numSources; ++i)
+                    matrix.addModSource({ "source" + std::to_string(i), &sources[static_cast<size_t>(i)] });
+
+                for (int i = 0; i < numDestinations; ++i)
+                {
+                    const auto name = "destination" + std::to_string(i);
+                    matrix.addModDestination({ name, &destinations[static_cast<size_t>(i)] });
+                    destinationBuffers[static_cast<size_t>(i)].allocate(blockSize);
+                    matrix.addAudioRateDestination(name, &destinationBuffers[static_cast<size_t>(i)]);
+                }
+
+                const auto rate = audioRate ? ChordialModMatrixCore::Rate::audio : ChordialModMatrixCore::Rate::control;
+                for (int row = 0; row < numRows; ++row)
+                    core->addRow("source" + std::to_string(row % numSources),
+                                 "destination" + std::to_string((row / numSources + row) % numDestinations),
+                                 true, 0.5f, rate);
+
+                matrix.prepare(blockSize, 100);
+
+                const auto caseName = "modmatrix/" + std::string(audioRate ? "audio/" : "control/") + std::to_string(numRows) + "rows";
+                run(results, options, getCaseName(caseName, sampleRate, blockSize), blockSize, [&]
+                {
+                    sources[0] = 1.0f - sources[0];
+                    matrix.process();
+                    matrix.processAudioRate(blockSize);
+                });
+            }
+        }
+
+        return results;
+    }
+
+    // numVoices ChordialVoices holding a note each, rendered one after another without
+    // a synthesiser around them, on the stereo and then the mono signal path. Samples are
+    // output sample frames of all voices together.
+    static std::vector<Result> runVoiceScaling(double sampleRate, size_t blockSize, const Options& options)
+    {
+        std::vector<Result> results;
+
+        for (const auto path : { ChordialVoice::SignalPath::stereo, ChordialVoice::SignalPath::mono })
+        {
+            for (const auto numVoices : options.voiceCounts)
+            {
+                auto core = std::make_shared<ChordialModMatrixCore>();
+                core->addRow(VOICE_ADSR1_OUT, VOICE_DCA_GAIN_IN, true);
+                core->addRow(VOICE_ADSR2_OUT, VOICE_FILTER_MASTER_CUTOFF_IN, true);
+
+                auto masterOscillator = std::make_shared<ChordialOscillatorMaster<float>>();
+                auto masterFilter = std::make_shared<ChordialFilterMaster<float>>();
+                ChordialMasterADSR<float, float> masterADSR1, masterADSR2;
+                masterADSR1.setSampleRate(sampleRate, 100);
+                masterADSR2.setSampleRate(sampleRate, 100);
+
+                const juce::dsp::ProcessSpec spec{ sampleRate, static_cast<juce::uint32>(blockSize), 2 };
+                ChordialSound sound;
+                std::vector<std::unique_ptr<ChordialVoice>> voices;
+
+                for (int i = 0; i < numVoices; ++i)
+                {
+                    voices.push_back(std::make_unique<ChordialVoice>(core, masterOscillator, masterFilter, masterADSR1, masterADSR2));
+                    voices.back()->setCurrentPlaybackSampleRate(sampleRate);
+                    voices.back()->setSignalPath(path);
+                    voices.back()->prepare(spec);
+                    voices.back()->startNote(36 + i % 60, 0.8f, &sound, 8192);
+                }
+
+                juce::AudioBuffer<float> buffer(2, static_cast<int>(blockSize));
+                run(results, options, getCaseName((path == ChordialVoice::SignalPath::mono ? "voiceMono/" : "voice/") + std::to_string(numVoices) + "voices", sampleRate, blockSize), blockSize, [&]
+                {
+                    buffer.clear();
+                    for (auto& voice : voices)
+                        voice->renderNextBlock(buffer, 0, static_cast<int>(blockSize));
+                });
+            }
+        }
+
+        return results;
+    }
+
+    // A whole ChordialSynthesiser with numVoices voices all holding notes, serial rendering
+    static std::vector<Result> runSynthScaling(double sampleRate, size_t blockSize, const Options& options)
+    {
+        std::vector<Result> results;
+
+        for (const auto numVoices : options.voiceCounts)
+        {
+            const auto caseName = getCaseName("synth/" + std::to_string(numVoices) + "voices", sampleRate, blockSize);
+            if (!isSelected(options, caseName))
+                continue;
+
+            ChordialOfflineRenderer::Settings settings;
+            settings.sampleRate = sampleRate;
+            settings.blockSize = static_cast<int>(blockSize);
+            settings.numVoices = numVoices;
+            ChordialOfflineRenderer::Host host(settings);
+
+            // More channels than notes per channel, as a repeated note on one channel steals its voice
+            juce::MidiBuffer notes;
+            for (int i = 0; i < numVoices; ++i)
+                notes.addEvent(juce::MidiMessage::noteOn(1 + i / 96, 24 + i % 96, 0.8f), 0);
+
+            juce::AudioBuffer<float> buffer(2, static_cast<int>(blockSize));
+            juce::MidiBuffer noMidi;
+            buffer.clear();
+            host.synth.renderNextBlock(buffer, notes, 0, static_cast<int>(blockSize));
+
+            run(results, options, caseName, blockSize, [&]
+            {
+                buffer.clear();
+                host.synth.renderNextBlock(buffer, noMidi, 0, static_cast<int>(blockSize));
+            });
+        }
+
+        return results;
+    }
+
+    // runSynthScaling() with each ChordialSynthesiser::VoiceScheduling and filter engine, the
+    // native one at its default 4x, at 8 to 256 voices
+    static std::vector<Result> runSchedulingComparison(double sampleRate, size_t blockSize, const Options& options)
+    {
+        using Scheduling = ChordialSynthesiser::VoiceScheduling;
+        using Engine = ChordialFilterMaster<float>::Engine;
+        struct Variant { Scheduling scheduling; Engine engine; std::string name; };
+        const Variant variants[] = {
+            { Scheduling::voiceMajor, Engine::juceLadder, "voiceMajor/juce" },
+            { Scheduling::stageMajor, Engine::juceLadder, "stageMajor/juce" },
+            { Scheduling::voiceMajor, Engine::chordialLadder, "voiceMajor/chordial" },
+            { Scheduling::stageMajor, Engine::chordialLadder, "stageMajor/chordial" }
+        };
+
+        std::vector<Result> results;
+
+        for (const auto& variant : variants)
+        {
+            for (const auto numVoices : { 8, 16, 32, 64, 128, 256 })
+            {
+                const auto caseName = getCaseName("scheduling/" + variant.name + "/" + std::to_string(numVoices) + "voices", sampleRate, blockSize);
+                if (!isSelected(options, caseName))
+                    continue;
+
+                ChordialOfflineRenderer::Settings settings;
+                settings.sampleRate = sampleRate;
+                settings.blockSize = static_cast<int>(blockSize);
+                settings.numVoices = numVoices;
+                ChordialOfflineRenderer::Host host(settings);
+                host.synth.setVoiceScheduling(variant.scheduling);
+                host.synth.setFilterEngine(variant.engine);
+                host.synth.prepareToPlay(sampleRate, static_cast<int>(blockSize));
+
+                juce::MidiBuffer notes;
+                for (int i = 0; i < numVoices; ++i)
+                    notes.addEvent(juce::MidiMessage::noteOn(1 + i / 96, 24 + i % 96, 0.8f), 0);
+
+                juce::AudioBuffer<float> buffer(2, static_cast<int>(blockSize));
+                juce::MidiBuffer noMidi;
+                buffer.clear();
+                host.synth.renderNextBlock(buffer, notes, 0, static_cast<int>(blockSize));
+
+                run(results, options, caseName, blockSize, [&]
+                {
+                    buffer.clear();
+                    host.synth.renderNextBlock(buffer, noMidi, 0, static_cast<int>(blockSize));
+                });
+            }
+        }
+
+        return results;
+    }
+
+    static juce::String toJSON(const std::vector<Result>& results)
+    {
+        auto* root = new juce::DynamicObject();
+        const juce::var rootVar(root);
+
+        root->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+        root->setProperty("juce_version", juce::SystemStats::getJUCEVersion());
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+        root->setProperty("compiler", getCompilerName());
+       #if JUCE_DEBUG
+        root->setProperty("configuration", "debug");
+       #else
+        root->setProperty("configuration", "release");
+       #endif
+        root->setProperty("simd_lanes", static_cast<int>(ChordialSIMDRegister<float>::SIMDNumElements));
+
+        juce::Array<juce::var> cases;
+        for (const auto& result : results)
+        {
+            auto* item = new juce::DynamicObject();
+            item->setProperty("name", juce::String(result.name));
+            item->setProperty("samples_per_second", result.samplesPerSecond);
+            item->setProperty("ns_per_sample", result.getNanosecondsPerSample());
+            cases.add(juce::var(item));
+        }
+        root->setProperty("results", cases);
+
+        return juce::JSON::toString(rootVar);
+    }
+
+private:
+    static std::string getCaseName(const std::string& name, double sampleRate, size_t blockSize)
+    {
+        return name + "/" + std::to_string(juce::roundToInt(sampleRate)) + "/" + std::to_string(blockSize);
+    }
+
+    static bool isSelected(const Options& options, const std::string& name)
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    template <typename RenderFunction>
+    static void run(std::vector<Result>& results, const Options& options, const std::string& name, size_t samplesPerCall, RenderFunction&& render)
+    {
+        if (isSelected(options, name))
+            results.push_back(measure(name, samplesPerCall, render, options.minimumSeconds));
+    }
+
+    static juce::AudioBuffer<float> makeNoise(int numChannels, size_t numSamples)
+    {
+        juce::AudioBuffer<float> noise(numChannels, static_cast<int>(numSamples));
+        juce::Random random(1);
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < static_cast<int>(numSamples); ++i)
+                noise.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+        return noise;
+    }
+
+    static void copyBuffer(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& destination)
+    {
+        for (int channel = 0; channel < destination.getNumChannels(); ++channel)
+            destination.copyFrom(channel, 0, source, channel, 0, destination.getNumSamples());
+    }
+
+    template <typename Envelope>
+    static void regate(Envelope& envelope, size_t& position, size_t blockSize, size_t samplesPerNote)
+    {
+        if (position == 0)
+            envelope.gate(true);
+        else if (position >= samplesPerNote / 2 && position < samplesPerNote / 2 + blockSize)
+            envelope.gate(false);
+
+        position += blockSize;
+        if (position >= samplesPerNote)
+            position = 0;
+    }
+
+    static juce::String getCompilerName()
+    {
+       #if defined(__clang__)
+        return "clang " __clang_version__;
+       #elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+       #elif defined(_MSC_VER)
+        return "msvc " + juce::String(_MSC_VER);
+       #else
+        return "unknown";
+       #endif
+    }
+};
+
+}
+}
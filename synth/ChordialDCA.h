@@ -14,6 +14,11 @@ namespace chordial
 namespace synth
 {
 
+/*  Voice gain, smoothed over a control period or taken per sample from an audio rate
+    modulation buffer. Besides process(), processAndAdd() is a fused output stage: one pass
+    per channel applies the gain (and a per-channel gain such as a pan) and accumulates into
+    another block, e.g. the host buffer, instead of gaining in place and adding after.
+*/
 template <typename SampleType>
 class ChordialDCAVoice : public ChordialModuleVoice<SampleType>
 {
@@ -21,22 +26,61 @@ public:
 
     void prepare(const juce::dsp::ProcessSpec& spec)
     {
-        gain.prepare(spec);
+        gainModulationBuffer.allocate(spec.maximumBlockSize);
         this->sampleRate = spec.sampleRate;
         this->updateDownSampleRate();
+        reset();
     }
 
     template <typename ProcessContext>
     void process(const ProcessContext &context)
     {
-        gain.setGainLinear(voiceGain * gainModulationInput);
-        gain.process(context);
+        auto& block = context.getOutputBlock();
+        updateTargetGain();
+
+        for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+        {
+            auto* samples = block.getChannelPointer(channel);
+            applyGain<false>(samples, samples, block.getNumSamples(), static_cast<SampleType>(1.0));
+        }
+
+        advance(block.getNumSamples());
+    }
+
+    // Adds source, gained, into destination. A mono source feeds every destination channel,
+    // otherwise channels pair up. channelGains, if given, weights destination channel c by
+    // channelGains[min(c, 1)].
+    void processAndAdd(const juce::dsp::AudioBlock<SampleType>& source, const juce::dsp::AudioBlock<SampleType>& destination,
+                       const SampleType* channelGains = nullptr)
+    {
+        jassert(source.getNumSamples() == destination.getNumSamples());
+        updateTargetGain();
+
+        const auto numSamples = source.getNumSamples();
+        const auto numSourceChannels = source.getNumChannels();
+        const auto numChannels = numSourceChannels == 1 ? destination.getNumChannels()
+                                                        : juce::jmin(numSourceChannels, destination.getNumChannels());
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            applyGain<true>(source.getChannelPointer(juce::jmin(channel, numSourceChannels - 1)), destination.getChannelPointer(channel),
+                            numSamples, channelGains != nullptr ? channelGains[juce::jmin<size_t>(channel, 1)] : static_cast<SampleType>(1.0));
+        }
+
+        advance(numSamples);
     }
 
+    // The largest gain magnitude the last process() or processAndAdd() applied
+    SampleType getPeakGain() const noexcept { return peakGain; }
+
     void reset()
     {
-        gain.reset();
+        currentGain = targetGain;
+        rampSamplesRemaining = 0;
     }
+
+    // Heap bytes owned
+    size_t getMemoryUsage() const noexcept { return gainModulationBuffer.getMemoryUsage(); }
     
     // always audio thread
     void setVoiceGain(float gain)
@@ -45,17 +89,111 @@ public:
     }
 
     SampleType* getGainModInputPtr() { return &gainModulationInput; }
+    ChordialModulationBuffer<SampleType>* getGainModInputBuffer() { return &gainModulationBuffer; }
 
 private:
+    // The ramp as LinearSmoothedValue::setTargetValue() starts it
+    void updateTargetGain()
+    {
+        if (gainModulationBuffer.active)
+            return;
+
+        const auto newTarget = voiceGain * gainModulationInput;
+        if (newTarget == targetGain)
+            return;
+
+        targetGain = newTarget;
+
+        if (stepsToTarget <= 0)
+        {
+            reset();
+            return;
+        }
+
+        rampSamplesRemaining = static_cast<size_t>(stepsToTarget);
+        gainStep = (targetGain - currentGain) / static_cast<SampleType>(stepsToTarget);
+    }
+
+    // destination[i] = (or +=) gain(i) * channelGain * source[i]. The ramp's gain is computed
+    // from its index rather than accumulated, so every segment vectorizes.
+    template <bool accumulate>
+    void applyGain(const SampleType* source, SampleType* destination, size_t numSamples, SampleType channelGain) const noexcept
+    {
+        if (gainModulationBuffer.active)
+        {
+            const auto* modulation = gainModulationBuffer.data.get();
+            const auto scale = voiceGain * channelGain;
+            for (size_t i = 0; i < numSamples; ++i)
+                write<accumulate>(destination[i], scale * modulation[i] * source[i]);
+            return;
+        }
+
+        const auto rampSamples = juce::jmin(numSamples, rampSamplesRemaining);
+        const auto start = currentGain * channelGain;
+        const auto step = gainStep * channelGain;
+
+        for (size_t i = 0; i < rampSamples; ++i)
+            write<accumulate>(destination[i], (start + step * static_cast<SampleType>(i + 1)) * source[i]);
+
+        // Past the ramp the gain sits at its target
+        const auto held = targetGain * channelGain;
+        for (size_t i = rampSamples; i < numSamples; ++i)
+            write<accumulate>(destination[i], held * source[i]);
+    }
+
+    template <bool accumulate>
+    static void write(SampleType& destination, SampleType value) noexcept
+    {
+        if (accumulate)
+            destination += value;
+        else
+            destination = value;
+    }
+
+    void advance(size_t numSamples)
+    {
+        if (numSamples == 0)
+            return;
+
+        if (gainModulationBuffer.active)
+        {
+            SampleType low, high;
+            juce::FloatVectorOperations::findMinAndMax(gainModulationBuffer.data.get(), static_cast<int>(numSamples), low, high);
+            peakGain = std::abs(voiceGain) * juce::jmax(-low, high);
+
+            // Picks up from the last gain applied in case the route returns to control rate
+            targetGain = voiceGain * gainModulationBuffer.data.get()[numSamples - 1];
+            reset();
+            return;
+        }
+
+        const auto rampSamples = juce::jmin(numSamples, rampSamplesRemaining);
+        const auto startGain = currentGain;
+        currentGain += gainStep * static_cast<SampleType>(rampSamples);
+        rampSamplesRemaining -= rampSamples;
+        if (rampSamplesRemaining == 0)
+            currentGain = targetGain;
+
+        // Linear, so the ends bound it
+        peakGain = juce::jmax(std::abs(rampSamples > 0 ? startGain : currentGain), std::abs(currentGain));
+    }
+
     void updateSmoothing(SampleType time) override
     {
-        gain.setRampDurationSeconds(time);
+        stepsToTarget = static_cast<int>(std::floor(time * this->sampleRate));
+        reset();
     }
 
-    juce::dsp::Gain<SampleType> gain;
     SampleType gainModulationInput{ static_cast<SampleType>(0.0) };
+    ChordialModulationBuffer<SampleType> gainModulationBuffer;
     SampleType voiceGain { 0.f };
-};
 
+    SampleType currentGain{ static_cast<SampleType>(0.0) };
+    SampleType targetGain{ static_cast<SampleType>(0.0) };
+    SampleType gainStep{ static_cast<SampleType>(0.0) };
+    SampleType peakGain{ static_cast<SampleType>(0.0) };
+    size_t rampSamplesRemaining{ 0 };
+    int stepsToTarget{ 0 };
+};
 }
 }
@@ -17,6 +17,8 @@ namespace synth
 template <typename SampleType, typename NumberType>
 class ChordialVoiceADSR;
 
+// Settings shared by every voice's envelope. Values are plain, so change them on the audio
+// thread (ChordialSynthesiser applies its parameter snapshot there) or before playback.
 template <typename SampleType, typename NumberType>
 class ChordialMasterADSR
 {
@@ -35,9 +37,12 @@ public:
         setTargetRatioDR(0.001);
     }
 
+    // rate is the audio rate; the envelope ticks once every underSamplingRatio samples,
+    // unless the voices render it with ChordialVoiceADSR::processBlock()
     void setSampleRate(double rate, int underSamplingRatio = 1)
     {
         sampleRate = rate / underSamplingRatio;
+        samplesPerTick = underSamplingRatio;
         updateAttackSamples();
         updateDecaySamples();
         updateReleaseSamples();
@@ -73,7 +78,7 @@ public:
 
     NumberType getSustainValue()
     {
-        return sustainValue.load();
+        return sustainValue;
     }
 
     void setReleaseTimeMs(NumberType ms)
@@ -94,6 +99,7 @@ public:
         targetRatioA = targetRatio;
         attackCoef = calcCoef(attackRate, targetRatioA);
         attackBase = (1.0 + targetRatioA) * (1.0 - attackCoef);
+        audioAttackCoef = calcCoef(attackRate * samplesPerTick, targetRatioA);
     }
 
     void setTargetRatioDR(float targetRatio)
@@ -105,6 +111,8 @@ public:
         releaseCoef = calcCoef(releaseRate, targetRatioDR);
         decayBase = (sustainValue - targetRatioDR) * (1.0 - decayCoef);
         releaseBase = -targetRatioDR * (1.0 - releaseCoef);
+        audioDecayCoef = calcCoef(decayRate * samplesPerTick, targetRatioDR);
+        audioReleaseCoef = calcCoef(releaseRate * samplesPerTick, targetRatioDR);
     }
 
     void setEnvelopeType(EnvelopeType type)
@@ -123,6 +131,7 @@ private:
         attackRate = (attackMs / 1000) * sampleRate;
         attackCoef = calcCoef(attackRate, targetRatioA);
         attackBase = (1.0 + targetRatioA) * (1.0 - attackCoef);
+        audioAttackCoef = calcCoef(attackRate * samplesPerTick, targetRatioA);
     }
 
     void updateDecaySamples()
@@ -130,6 +139,7 @@ private:
         decayRate = (decayMs / 1000) * sampleRate;
         decayCoef = calcCoef(decayRate, targetRatioDR);
         decayBase = (sustainValue - targetRatioDR) * (1.0 - decayCoef);
+        audioDecayCoef = calcCoef(decayRate * samplesPerTick, targetRatioDR);
     }
 
     void updateReleaseSamples()
@@ -137,6 +147,7 @@ private:
         releaseRate = (releaseMs / 1000) * sampleRate;
         releaseCoef = calcCoef(releaseRate, targetRatioDR);
         releaseBase = -targetRatioDR * (1.0 - releaseCoef);
+        audioReleaseCoef = calcCoef(releaseRate * samplesPerTick, targetRatioDR);
     }
 
     float calcCoef(float rate, float targetRatio)
@@ -144,18 +155,22 @@ private:
         return (rate <= 0) ? 0.0 : exp(-log((1.0 + targetRatio) / targetRatio) / rate);
     }
 
-    std::atomic<EnvelopeType> envelopeType; // Atomic
+    EnvelopeType envelopeType;
 
 
     double sampleRate;
+    int samplesPerTick{ 1 };
 
     NumberType attackMs, decayMs, releaseMs;
     NumberType attackRate, decayRate, releaseRate;
-    std::atomic<NumberType> sustainValue; // Atomic
+    NumberType sustainValue;
 
-    std::atomic<NumberType> attackCoef, decayCoef, releaseCoef; // Atomic
+    NumberType attackCoef, decayCoef, releaseCoef;
     NumberType targetRatioA, targetRatioDR;
-    std::atomic<NumberType> attackBase, decayBase, releaseBase; // Atomic
+    NumberType attackBase, decayBase, releaseBase;
+
+    // Per-sample coefficients of the same curves, for processBlock()
+    NumberType audioAttackCoef{ 0 }, audioDecayCoef{ 0 }, audioReleaseCoef{ 0 };
 
     friend class ChordialVoiceADSR<SampleType, NumberType>;
 };
@@ -172,15 +187,14 @@ public:
 
     SampleType getNextValue()
     {
-        // Get atomic variables
-        const auto envLocal = master.envelopeType.load();
-        const auto susLocal = master.sustainValue.load();
-        const auto attackCoefLocal = master.attackCoef.load();
-        const auto decayCoefLocal = master.decayCoef.load();
-        const auto releaseCoefLocal = master.releaseCoef.load();
-        const auto attackBaseLocal = master.attackBase.load();
-        const auto decayBaseLocal = master.decayBase.load();
-        const auto releaseBaseLocal = master.releaseBase.load();
+        const auto envLocal = master.envelopeType;
+        const auto susLocal = master.sustainValue;
+        const auto attackCoefLocal = master.attackCoef;
+        const auto decayCoefLocal = master.decayCoef;
+        const auto releaseCoefLocal = master.releaseCoef;
+        const auto attackBaseLocal = master.attackBase;
+        const auto decayBaseLocal = master.decayBase;
+        const auto releaseBaseLocal = master.releaseBase;
 
         switch (state) {
         case State::idle:
@@ -218,6 +232,105 @@ public:
         return output;
     }
 
+    /*  Renders the envelope at the audio rate into destination, one value per sample.
+
+        Each exponential segment has the closed form y[k] = a + c^k * (y[0] - a), with a the
+        asymptote the attack/decay/release recurrences head for, so the sample at which a
+        segment reaches its end is solved for directly and the values up to it are written
+        a register width at a time from the powers c^1..c^lanes. getOutput() is the last
+        value written.
+    */
+    void processBlock(SampleType* destination, size_t numSamples)
+    {
+        const auto sustain = master.sustainValue;
+
+        for (size_t position = 0; position < numSamples;)
+        {
+            auto* samples = destination + position;
+            const auto remaining = numSamples - position;
+
+            switch (state) {
+            case State::idle:
+                std::fill(samples, samples + remaining, output);
+                position = numSamples;
+                break;
+
+            case State::attack:
+                position += renderSegment(samples, remaining, master.audioAttackCoef,
+                                          1.0 + master.targetRatioA, 1.0, State::decay);
+                break;
+
+            case State::decay:
+                position += renderSegment(samples, remaining, master.audioDecayCoef,
+                                          sustain - master.targetRatioDR, sustain, State::sustain);
+                break;
+
+            case State::sustain:
+                output = sustain;
+                if (master.envelopeType == ChordialMasterADSR<SampleType, NumberType>::EnvelopeType::oneHit)
+                {
+                    *samples = output;
+                    state = State::release;
+                    ++position;
+                }
+                else
+                {
+                    std::fill(samples, samples + remaining, output);
+                    position = numSamples;
+                }
+                break;
+
+            case State::release:
+                position += renderSegment(samples, remaining, master.audioReleaseCoef,
+                                          -master.targetRatioDR, 0.0, State::idle);
+            }
+        }
+    }
+
+    // Moves the envelope numSamples along the audio rate curve without rendering it, for
+    // control ticks that aren't evenly spaced
+    SampleType advance(size_t numSamples)
+    {
+        const auto sustain = master.sustainValue;
+
+        for (size_t position = 0; position < numSamples;)
+        {
+            const auto remaining = numSamples - position;
+
+            switch (state) {
+            case State::idle:
+                position = numSamples;
+                break;
+
+            case State::attack:
+                position += advanceSegment(remaining, master.audioAttackCoef, 1.0 + master.targetRatioA, 1.0, State::decay);
+                break;
+
+            case State::decay:
+                position += advanceSegment(remaining, master.audioDecayCoef, sustain - master.targetRatioDR, sustain, State::sustain);
+                break;
+
+            case State::sustain:
+                output = sustain;
+                if (master.envelopeType == ChordialMasterADSR<SampleType, NumberType>::EnvelopeType::oneHit)
+                {
+                    state = State::release;
+                    ++position;
+                }
+                else
+                {
+                    position = numSamples;
+                }
+                break;
+
+            case State::release:
+                position += advanceSegment(remaining, master.audioReleaseCoef, -master.targetRatioDR, 0.0, State::idle);
+            }
+        }
+
+        return output;
+    }
+
     SampleType getOutput()
     {
         return output;
@@ -247,6 +360,16 @@ public:
         return state != State::idle;
     }
 
+    bool isReleasing()
+    {
+        return state == State::release;
+    }
+
+    bool isInAttackOrDecay()
+    {
+        return state == State::attack || state == State::decay;
+    }
+
 private:
     enum class State
     {
@@ -257,6 +380,92 @@ private:
         release
     };
 
+    // Samples until the segment heading from output towards asymptote passes end, or
+    // numSamples + 1 if it doesn't within numSamples. The recurrence passes end at the
+    // first k with c^k <= (end - a) / (y[0] - a).
+    size_t getSegmentLength(size_t numSamples, NumberType coef, NumberType asymptote, NumberType end) const
+    {
+        const auto ratio = static_cast<double>(end - asymptote) / static_cast<double>(output - asymptote);
+        if (coef <= 0 || !(ratio > 0.0 && ratio < 1.0))
+            return 1;
+
+        const auto k = std::ceil(std::log(ratio) / std::log(static_cast<double>(coef)));
+        if (k < static_cast<double>(numSamples + 1))
+            return juce::jmax(static_cast<size_t>(1), static_cast<size_t>(k));
+
+        return numSamples + 1;
+    }
+
+    // Writes the segment until it passes end, which becomes the last value written, then
+    // moves on to nextState. Returns the samples written.
+    size_t renderSegment(SampleType* samples, size_t numSamples, NumberType coef,
+                         NumberType asymptote, NumberType end, State nextState)
+    {
+        constexpr size_t lanes = ChordialSIMDRegister<SampleType>::SIMDNumElements;
+
+        const auto length = getSegmentLength(numSamples, coef, asymptote, end);
+        const auto count = juce::jmin(length, numSamples);
+        const auto rising = asymptote > end;
+
+        SampleType powers[lanes];
+        auto power = static_cast<SampleType>(coef);
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            powers[lane] = power;
+            power *= static_cast<SampleType>(coef);
+        }
+        const auto stride = powers[lanes - 1];
+
+        const auto a = static_cast<SampleType>(asymptote);
+        const auto e = static_cast<SampleType>(end);
+        auto distance = output - a;
+
+        // Whole register widths first, clamped so rounding never overshoots the segment's end
+        const auto numFull = count - count % lanes;
+        for (size_t i = 0; i < numFull; i += lanes)
+        {
+            if (rising)
+                for (size_t lane = 0; lane < lanes; ++lane)
+                    samples[i + lane] = juce::jmin(a + distance * powers[lane], e);
+            else
+                for (size_t lane = 0; lane < lanes; ++lane)
+                    samples[i + lane] = juce::jmax(a + distance * powers[lane], e);
+
+            distance *= stride;
+        }
+
+        for (size_t i = numFull; i < count; ++i)
+        {
+            const auto y = a + distance * powers[i - numFull];
+            samples[i] = rising ? juce::jmin(y, e) : juce::jmax(y, e);
+        }
+
+        if (length <= numSamples)
+        {
+            samples[count - 1] = e;
+            state = nextState;
+        }
+
+        output = samples[count - 1];
+        return count;
+    }
+
+    // renderSegment() without the rendering
+    size_t advanceSegment(size_t numSamples, NumberType coef, NumberType asymptote, NumberType end, State nextState)
+    {
+        const auto length = getSegmentLength(numSamples, coef, asymptote, end);
+        if (length <= numSamples)
+        {
+            output = static_cast<SampleType>(end);
+            state = nextState;
+            return length;
+        }
+
+        const auto decay = std::pow(static_cast<double>(coef), static_cast<double>(numSamples));
+        output = static_cast<SampleType>(asymptote + decay * (output - asymptote));
+        return numSamples;
+    }
+
     ChordialMasterADSR<SampleType, NumberType>& master;
     State state;
     SampleType output;
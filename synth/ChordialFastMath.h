@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    ChordialFastMath.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Single precision exp2, log2 and pow approximations for control rate pitch and
+    cutoff maths, plus MIDI note tables built at compile time.
+
+    Each function has two accuracy tiers, stated as the pitch error of a frequency they
+    produce: cent (within 1 cent, a relative error of 5.8e-4) and tenthCent (within 0.1
+    cent, 5.8e-5). They are branch-free, reinterpret floats with memcpy and use no tables,
+    so loops over arrays of them vectorize.
+
+    The synth's call sites go through octavesToRatio(), getKeyTrackingRatio() and
+    getMidiNoteInHertz() below, which use these with CHORDIAL_FAST_MATH set (1 for the cent
+    tier, 2 for tenthCent) and the std and JUCE functions they replaced otherwise.
+*/
+namespace fastmath
+{
+    enum class Accuracy
+    {
+        cent,
+        tenthCent
+    };
+
+    namespace detail
+    {
+        inline juce::int32 toBits(float x) noexcept
+        {
+            juce::int32 bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            return bits;
+        }
+
+        inline float fromBits(juce::int32 bits) noexcept
+        {
+            float x;
+            std::memcpy(&x, &bits, sizeof(x));
+            return x;
+        }
+    }
+
+    // 2^x for x in [-125, 128). The fraction's minimax polynomial is within 7.5e-5 (cent,
+    // 0.13 cents) or 2.6e-6 (tenthCent) relative error; the integer part goes straight into
+    // the exponent. x isn't clamped, as without -ffast-math a float clamp stops GCC
+    // vectorizing the loop around it.
+    template <Accuracy accuracy = Accuracy::tenthCent>
+    inline float exp2(float x) noexcept
+    {
+        jassert(x >= -125.0f && x < 128.0f);
+
+        // Truncating the positive x + 128 floors x
+        const auto integer = static_cast<juce::int32>(x + 128.0f) - 128;
+        const auto f = x - static_cast<float>(integer);
+
+        float p;
+        if (accuracy == Accuracy::cent)
+            p = 0.9999253112f + f * (0.6958330508f + f * (0.2260674479f + f * 0.07802481235f));
+        else
+            p = 1.00000259f + f * (0.69300387f + f * (0.2414426784f + f * (0.05201148719f + f * 0.01353419454f)));
+
+        return detail::fromBits(detail::toBits(p) + integer * (1 << 23));
+    }
+
+    // log2(x) for normal x > 0. The mantissa is folded into [sqrt(1/2), sqrt(2)) around a
+    // minimax polynomial within 1.0e-4 (cent, 0.12 cents) or 1.5e-5 (tenthCent) absolute.
+    template <Accuracy accuracy = Accuracy::tenthCent>
+    inline float log2(float x) noexcept
+    {
+        const auto bits = detail::toBits(x);
+        const auto mantissa = bits & 0x007fffff;
+
+        // 1 when the mantissa is at least sqrt(2), which then gets exponent -1 instead of 0
+        const auto fold = static_cast<juce::int32>(mantissa >= 0x003504f3);
+        const auto exponent = static_cast<float>(((bits >> 23) & 0xff) - 127 + fold);
+        const auto m = detail::fromBits(mantissa | (0x3f800000 - fold * (1 << 23)));
+
+        const auto t = m - 1.0f;
+        float p;
+        if (accuracy == Accuracy::cent)
+            p = t * (1.441760346f + t * (-0.7249046472f + t * (0.5175155827f + t * -0.3296330629f)));
+        else
+            p = t * (1.442577984f + t * (-0.7202415552f + t * (0.4866867495f + t * (-0.3945793445f + t * 0.2526620817f))));
+
+        return exponent + p;
+    }
+
+    // base^y for base > 0, as exp2(y * log2(base)): exp2's relative error plus y times
+    // log2's absolute error, in octaves
+    template <Accuracy accuracy = Accuracy::tenthCent>
+    inline float pow(float base, float y) noexcept
+    {
+        return exp2<accuracy>(y * log2<accuracy>(base));
+    }
+
+    // Equal tempered ratios from a reference note, built at compile time from the twelve
+    // semitone ratios of one octave and exact powers of two
+    struct NoteRatioTable
+    {
+        static constexpr int numNotes = 128;
+
+        constexpr explicit NoteRatioTable(int referenceNote, double referenceValue) : values()
+        {
+            constexpr double semitones[12] = {
+                1.0, 1.0594630943592953, 1.122462048309373, 1.189207115002721,
+                1.2599210498948732, 1.3348398541700344, 1.4142135623730951, 1.4983070768766815,
+                1.5874010519681994, 1.6817928305074290, 1.7817974362806785, 1.8877486253633868
+            };
+
+            for (int note = 0; note < numNotes; ++note)
+            {
+                // note - referenceNote as 12 * octave + semitone, semitone in [0, 12)
+                const auto offset = note - referenceNote + 12 * numNotes;
+                auto value = referenceValue * semitones[offset % 12];
+                for (int octave = offset / 12 - numNotes; octave > 0; --octave)
+                    value *= 2.0;
+                for (int octave = offset / 12 - numNotes; octave < 0; ++octave)
+                    value *= 0.5;
+                values[note] = value;
+            }
+        }
+
+        double operator[](int note) const noexcept { return values[juce::jlimit(0, numNotes - 1, note)]; }
+
+        double values[numNotes];
+    };
+
+    // The filter's keyboard tracking pivots on E4
+    constexpr int keyTrackingReferenceNote = 64;
+
+    inline const NoteRatioTable& getMidiNoteInHertzTable() noexcept
+    {
+        static constexpr NoteRatioTable table(69, 440.0);
+        return table;
+    }
+
+    inline const NoteRatioTable& getKeyTrackingTable() noexcept
+    {
+        static constexpr NoteRatioTable table(keyTrackingReferenceNote, 1.0);
+        return table;
+    }
+
+    // The synth's call sites, switched by CHORDIAL_FAST_MATH
+
+    // 2^octaves, for detune, frequency modulation and cutoff modulation
+    inline double octavesToRatio(double octaves) noexcept
+    {
+       #if CHORDIAL_FAST_MATH
+        return exp2<CHORDIAL_FAST_MATH == 1 ? Accuracy::cent : Accuracy::tenthCent>(static_cast<float>(octaves));
+       #else
+        return std::pow(2.0, octaves);
+       #endif
+    }
+
+    // 2^((midiNoteNumber - 64) / 12)
+    inline double getKeyTrackingRatio(int midiNoteNumber) noexcept
+    {
+       #if CHORDIAL_FAST_MATH
+        return getKeyTrackingTable()[midiNoteNumber];
+       #else
+        return std::pow(2.0, (midiNoteNumber - keyTrackingReferenceNote) / 12.0);
+       #endif
+    }
+
+    inline double getMidiNoteInHertz(int midiNoteNumber) noexcept
+    {
+       #if CHORDIAL_FAST_MATH
+        return getMidiNoteInHertzTable()[midiNoteNumber];
+       #else
+        return juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+       #endif
+    }
+}
+
+}
+}
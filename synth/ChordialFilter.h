@@ -17,40 +17,90 @@ namespace synth
 template <typename SampleType>
 class ChordialFilterVoice;
 
+template <typename SampleType>
+class ChordialFilterBank;
+
+// Settings shared by every voice's filter. Engine and oversampling can be switched from any
+// thread; cutoff, resonance and mod depth are plain, so change them on the audio thread
+// (ChordialSynthesiser applies its parameter snapshot there) or before playback.
 template <typename SampleType>
 class ChordialFilterMaster
 {
 public:
+    // juceLadder runs a juce::dsp::LadderFilter per voice, chordialLadder the SIMD ChordialLadderFilter,
+    // with a lane per channel. Only a ChordialFilterBank fills the lanes from several voices.
+    enum class Engine
+    {
+        juceLadder,
+        chordialLadder
+    };
+
     ChordialFilterMaster() {}
 
+    // Real-time safe, voices switch engine at their next block
+    void setEngine(Engine newEngine)
+    {
+        engine.store(newEngine);
+    }
+
+    Engine getEngine()
+    {
+        return engine.load();
+    }
+
+    // Oversampling of the chordialLadder engine as a power of two, 0 (1x) to 3 (8x). The
+    // juceLadder engine always runs its own 4x juce::dsp::Oversampling. Real-time safe.
+    void setOversamplingFactor(int factorLog2)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(factorLog2, ChordialOversampler<SampleType>::maxFactorLog2));
+        oversamplingFactor.store(factorLog2);
+    }
+
+    int getOversamplingFactor()
+    {
+        return oversamplingFactor.load();
+    }
+
+    // When enabled, each voice runs at the lowest factor up to the one set above that its
+    // cutoff, resonance and note pitch allow
+    void setAdaptiveOversampling(bool shouldAdapt)
+    {
+        adaptiveOversampling.store(shouldAdapt);
+    }
+
+    bool getAdaptiveOversampling()
+    {
+        return adaptiveOversampling.load();
+    }
+
     void setCutoff(SampleType hz)
     {
-        cutoff.store(hz);
+        cutoff = hz;
     }
 
     SampleType getCutoff()
     {
-        return cutoff.load();
+        return cutoff;
     }
 
     void setResonance(SampleType value)
     {
-        resonance.store(value);
+        resonance = value;
     }
 
     SampleType getResonance()
     {
-        return resonance.load();
+        return resonance;
     }
 
     void setCutoffModDepth(SampleType value)
     {
-        cutoffModDepth.store(value);
+        cutoffModDepth = value;
     }
 
     SampleType getCutoffModDepth()
     {
-        return cutoffModDepth.load();
+        return cutoffModDepth;
     }
 
     SampleType* getCutoffModPtr()
@@ -59,10 +109,13 @@ public:
     }
 private:
     friend class ChordialFilterVoice<SampleType>;
-    std::atomic<SampleType> cutoff{ static_cast<SampleType>(329.63) };
-    std::atomic<SampleType> resonance{ static_cast<SampleType>(0.0) };
+    SampleType cutoff{ static_cast<SampleType>(329.63) };
+    SampleType resonance{ static_cast<SampleType>(0.0) };
     SampleType cutoffMod{ static_cast<SampleType>(0.0) };
-    std::atomic<SampleType> cutoffModDepth{ static_cast<SampleType>(4.0) };
+    SampleType cutoffModDepth{ static_cast<SampleType>(4.0) };
+    std::atomic<Engine> engine{ Engine::juceLadder };
+    std::atomic<int> oversamplingFactor{ 2 };
+    std::atomic<bool> adaptiveOversampling{ false };
 };
 
 template <typename SampleType>
@@ -74,7 +127,8 @@ public:
         filter.setMode(juce::dsp::LadderFilter<SampleType>::Mode::LPF24);
         filter.setEnabled(true);
         filter.setDrive(1);
-
+        chordialFilter.setMode(juce::dsp::LadderFilter<SampleType>::Mode::LPF24);
+        chordialFilter.setDrive(1);
     }
 
     void setMasterFilter(std::shared_ptr<ChordialFilterMaster<float>> masterFilter)
@@ -82,58 +136,290 @@ public:
         master = masterFilter;
     }
 
+    // Bytes of the native engine's working buffers, see setScratch()
+    static size_t getScratchSize(const juce::dsp::ProcessSpec& spec) noexcept
+    {
+        return layOutScratch(nullptr, spec);
+    }
+
+    // Puts the native engine's working buffers in memory of getScratchSize() bytes, aligned
+    // as a ChordialScratchArena, which can be shared with anything not running during
+    // process(). The JUCE engine keeps its own: juce::dsp::Oversampling holds filter state
+    // in its buffers. Not real-time safe, call before prepare(); nullptr goes back to allocating.
+    void setScratch(char* memory) noexcept { scratch = memory; }
+
     void prepare(const juce::dsp::ProcessSpec& spec)
     {
         oversampling = std::make_unique<juce::dsp::Oversampling<SampleType>> (spec.numChannels, 2, juce::dsp::Oversampling<SampleType>::FilterType::filterHalfBandPolyphaseIIR);
         oversampling->initProcessing(spec.maximumBlockSize);
+        juceOversamplingChannels = spec.numChannels;
+        juceOversamplingBlockSize = spec.maximumBlockSize;
 
         juce::dsp::ProcessSpec specOS;
         specOS.sampleRate = spec.sampleRate * oversampling->getOversamplingFactor();
         specOS.maximumBlockSize = spec.maximumBlockSize * oversampling->getOversamplingFactor();
         specOS.numChannels = spec.numChannels;
         filter.prepare(specOS);
+
+        sampleRate = spec.sampleRate;
+        oversamplingFactor = master != nullptr ? master->oversamplingFactor.load() : 2;
+        ownedInterleaved = {};
+        if (scratch != nullptr)
+        {
+            layOutScratch(this, spec);
+        }
+        else
+        {
+            chordialOversampler.setScratch(nullptr);
+            chordialFilter.setScratch(nullptr);
+            ownedInterleaved.allocate(ChordialOversampler<SampleType>::lanes * spec.maximumBlockSize);
+            interleaved = ownedInterleaved.get();
+        }
+
+        chordialOversampler.prepare(spec.numChannels, spec.maximumBlockSize);
+        chordialFilter.prepare(sampleRate * (1 << oversamplingFactor), spec.numChannels,
+                               spec.maximumBlockSize << ChordialOversampler<SampleType>::maxFactorLog2);
+    }
+
+    // Heap bytes owned, i.e. excluding shared scratch. juce::dsp::Oversampling can't be
+    // asked, so its part is estimated from its two stages' buffers at 2x and 4x the block.
+    size_t getMemoryUsage() const noexcept
+    {
+        size_t bytes = ownedInterleaved.getMemoryUsage() + chordialOversampler.getMemoryUsage() + chordialFilter.getMemoryUsage();
+        if (oversampling != nullptr)
+            bytes += sizeof(juce::dsp::Oversampling<SampleType>) + (2 + 4) * juceOversamplingChannels * juceOversamplingBlockSize * sizeof(SampleType);
+        return bytes;
     }
 
     template <typename ProcessContext>
     void process(const ProcessContext &context)
     {
-        updateCutoff();
-        filter.setResonance(master->resonance.load());
-        const auto& inBlock = context.getInputBlock();
-        auto upSampled = oversampling->processSamplesUp(inBlock);
-        ProcessContext contextOS(upSampled);
-        filter.process(contextOS);
-        oversampling->processSamplesDown(context.getOutputBlock());
+        updateEngine();
+
+        if (engine == Engine::chordialLadder)
+        {
+            updateChordialLadder();
+            processChordialLadder(context.getOutputBlock());
+            return;
+        }
+
+        processJuceLadder(context);
+    }
+
+    // process() for stage-batched rendering. The chordialLadder engine queues the block on
+    // bank, to be oversampled and filtered together with other voices' channels by
+    // bank.process(); the JUCE engine filters it now.
+    template <typename ProcessContext>
+    void process(const ProcessContext& context, ChordialFilterBank<SampleType>& bank)
+    {
+        updateEngine();
+
+        if (engine != Engine::chordialLadder)
+        {
+            processJuceLadder(context);
+            return;
+        }
+
+        updateChordialLadder();
+        bank.add(*this, context.getOutputBlock(), oversamplingFactor);
     }
 
     void reset()
     {
 		updateCutoff();
         filter.reset();
+        chordialFilter.reset();
+        chordialOversampler.reset();
     }
 
     void setNoteNumber(int noteNumber)
     {
-        keyboardTrackValue = std::pow(2.0, (noteNumber - 64) / 12.0);
+        keyboardTrackValue = fastmath::getKeyTrackingRatio(noteNumber);
+        noteFrequency = static_cast<SampleType>(fastmath::getMidiNoteInHertz(noteNumber));
     }
 
     SampleType* getCutoffModVoicePtr() { return &cutoffModVoice; }
 
+    // Where the oversampling spans go when built with CHORDIAL_TRACE
+    void setTraceLane(ChordialTraceLane* lane, int voiceIndex) noexcept
+    {
+        traceLane = lane;
+        traceVoiceIndex = voiceIndex;
+    }
+
 private:
+    friend class ChordialFilterBank<SampleType>;
+    using Engine = ChordialFilterMaster<float>::Engine;
+
+    void updateEngine()
+    {
+        const auto localEngine = master->engine.load();
+        if (localEngine != engine)
+        {
+            engine = localEngine;
+            reset();
+        }
+    }
+
+    template <typename ProcessContext>
+    void processJuceLadder(const ProcessContext& context)
+    {
+        updateCutoff();
+        updateResonance();
+        const auto& inBlock = context.getInputBlock();
+        juce::dsp::AudioBlock<SampleType> upSampled;
+        {
+            CHORDIAL_TRACE_SCOPE(traceLane, "filterOversampleUp", traceVoiceIndex, 2);
+            upSampled = oversampling->processSamplesUp(inBlock);
+        }
+        ProcessContext contextOS(upSampled);
+        filter.process(contextOS);
+        {
+            CHORDIAL_TRACE_SCOPE(traceLane, "filterOversampleDown", traceVoiceIndex, 2);
+            oversampling->processSamplesDown(context.getOutputBlock());
+        }
+    }
+
+    // Measures the scratch with voice == nullptr, else hands it out to voice's buffers
+    static size_t layOutScratch(ChordialFilterVoice* voice, const juce::dsp::ProcessSpec& spec) noexcept
+    {
+        using Oversampler = ChordialOversampler<SampleType>;
+        const auto oversampledBlockSize = static_cast<size_t>(spec.maximumBlockSize) << Oversampler::maxFactorLog2;
+
+        ChordialScratchArena::Carver carver(voice != nullptr ? voice->scratch : nullptr);
+        auto* interleavedRegion = carver.take<SampleType>(Oversampler::lanes * spec.maximumBlockSize);
+        auto* oversamplerRegion = carver.take<char>(Oversampler::getScratchSize(spec.maximumBlockSize));
+        auto* filterRegion = carver.take<char>(ChordialLadderFilter<SampleType>::getScratchSize(spec.numChannels, oversampledBlockSize));
+
+        if (voice != nullptr)
+        {
+            voice->interleaved = interleavedRegion;
+            voice->chordialOversampler.setScratch(oversamplerRegion);
+            voice->chordialFilter.setScratch(filterRegion);
+        }
+
+        return carver.getNumBytesUsed();
+    }
+
+    // Picks the oversampling factor for the next sub-block and sets the lanes' cutoff and
+    // resonance targets at it
+    void updateChordialLadder()
+    {
+        const auto factor = chooseOversamplingFactor(getCutoff(), master->resonance);
+        if (factor != oversamplingFactor)
+        {
+            oversamplingFactor = factor;
+            chordialFilter.setSampleRate(sampleRate * (1 << oversamplingFactor));
+        }
+
+        updateCutoff();
+        updateResonance();
+    }
+
+    // The native oversampler and ladder run the voice's channels as lanes of one pass
+    void processChordialLadder(const juce::dsp::AudioBlock<SampleType>& block)
+    {
+        const auto numSamples = block.getNumSamples();
+        constexpr auto lanes = ChordialOversampler<SampleType>::lanes;
+
+        for (size_t group = 0; group * lanes < block.getNumChannels(); ++group)
+        {
+            simd::interleave(block, group * lanes, interleaved);
+            SampleType* upsampled;
+            {
+                CHORDIAL_TRACE_SCOPE(traceLane, "filterOversampleUp", traceVoiceIndex, oversamplingFactor);
+                upsampled = chordialOversampler.processUp(group, interleaved, numSamples, oversamplingFactor);
+            }
+            chordialFilter.processInterleaved(group, upsampled, numSamples << oversamplingFactor);
+            {
+                CHORDIAL_TRACE_SCOPE(traceLane, "filterOversampleDown", traceVoiceIndex, oversamplingFactor);
+                chordialOversampler.processDown(group, interleaved, numSamples, oversamplingFactor);
+            }
+            simd::deinterleave(interleaved, group * lanes, block);
+        }
+    }
+
+    // Lowest factor at which the cutoff sits below 0.12 of the oversampled rate (0.06 once
+    // resonance passes 0.5, as self-oscillation saturates) and the note below 1/48 of it.
+    // Dropping to a lower factor needs 20% headroom so a voice does not toggle at a boundary.
+    int chooseOversamplingFactor(SampleType cutoffHz, SampleType resonanceValue) const
+    {
+        const auto maximum = master->oversamplingFactor.load();
+        if (!master->adaptiveOversampling.load())
+            return maximum;
+
+        const auto cutoffLimit = resonanceValue > static_cast<SampleType>(0.5) ? 0.06 : 0.12;
+
+        for (int factor = 0; factor < maximum; ++factor)
+        {
+            const auto headroom = factor < oversamplingFactor ? 0.8 : 1.0;
+            const auto rate = sampleRate * (1 << factor) * headroom;
+
+            if (cutoffHz <= cutoffLimit * rate && noteFrequency <= rate / 48.0)
+                return factor;
+        }
+
+        return maximum;
+    }
+
+    SampleType getCutoff() const
+    {
+        return static_cast<SampleType>(keyboardTrackValue * master->cutoff * fastmath::octavesToRatio(cutoffModVoice * master->cutoffModDepth));
+    }
+
     void updateCutoff()
     {
         if (master != nullptr)
         {
-            auto freq = keyboardTrackValue * master->cutoff.load() * std::pow(2.0,cutoffModVoice*master->cutoffModDepth.load());
-            filter.setCutoffFrequencyHz(freq);
+            auto freq = getCutoff();
+            if (engine == Engine::chordialLadder)
+            {
+                for (size_t lane = 0; lane < chordialFilter.getNumLanes(); ++lane)
+                    chordialFilter.setCutoffFrequencyHz(lane, freq);
+            }
+            else
+            {
+                filter.setCutoffFrequencyHz(freq);
+            }
+        }
+    }
+
+    void updateResonance()
+    {
+        if (master != nullptr)
+        {
+            const auto value = master->resonance;
+
+            if (engine == Engine::chordialLadder)
+            {
+                for (size_t lane = 0; lane < chordialFilter.getNumLanes(); ++lane)
+                    chordialFilter.setResonance(lane, value);
+            }
+            else
+            {
+                filter.setResonance(value);
+            }
         }
     }
 
     std::shared_ptr<ChordialFilterMaster<float>> master;
     juce::dsp::LadderFilter<SampleType> filter;
+    ChordialLadderFilter<SampleType> chordialFilter;
+    ChordialOversampler<SampleType> chordialOversampler;
+    ChordialAlignedBuffer<SampleType> ownedInterleaved;
+    SampleType* interleaved{ nullptr };
+    char* scratch{ nullptr };
+    Engine engine{ Engine::juceLadder };
+    double sampleRate{ 44100.0 };
+    int oversamplingFactor{ 2 };
     SampleType cutoffModVoice{ static_cast<SampleType>(0.0) };
     SampleType keyboardTrackValue{ static_cast<SampleType>(1.0) };
+    SampleType noteFrequency{ static_cast<SampleType>(440.0) };
     std::unique_ptr<juce::dsp::Oversampling<SampleType>> oversampling;
+    size_t juceOversamplingChannels{ 0 };
+    size_t juceOversamplingBlockSize{ 0 };
+    ChordialTraceLane* traceLane{ nullptr };
+    int traceVoiceIndex{ -1 };
 };
 }
 }
@@ -0,0 +1,214 @@
+/*
+  ==============================================================================
+
+    ChordialFilterBank.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Runs the chordialLadder filters of many voices together, for stage-batched rendering.
+    Voices queue a control sub-block each with ChordialFilterVoice::process(context, bank),
+    and process() packs the queued channels, whichever voices they come from, into full
+    groups of ChordialSIMDRegister::SIMDNumElements lanes.
+
+    Each channel's oversampler and ladder state is copied into its lane of the bank's own
+    one-group ChordialOversampler and ChordialLadderFilter. The group is oversampled,
+    filtered and brought back down, and the state is copied back. So the state stays with
+    the voice, and rendering voice by voice carries on from it.
+
+    All lanes of a group must filter the same number of samples at the same oversampling
+    factor, so process() sorts the queue by both first. Voices that tick on the same control
+    schedule fill whole groups; others can leave lanes idle, running on silence.
+*/
+template <typename SampleType>
+class ChordialFilterBank
+{
+public:
+    using Oversampler = ChordialOversampler<SampleType>;
+    using Ladder = ChordialLadderFilter<SampleType>;
+
+    static constexpr size_t lanes = Ladder::lanes;
+
+    ChordialFilterBank()
+    {
+        // The kernel runs with the bank's mode and drive, so they match ChordialFilterVoice's
+        ladder.setMode(juce::dsp::LadderFilter<SampleType>::Mode::LPF24);
+        ladder.setDrive(1);
+    }
+
+    // Bytes of the working buffers, see setScratch()
+    static size_t getScratchSize(const juce::dsp::ProcessSpec& spec) noexcept
+    {
+        return layOutScratch(nullptr, spec);
+    }
+
+    // As ChordialFilterVoice::setScratch(). The buffers are only used within process(), so
+    // they can share a ChordialScratchArena with the voices' render scratch.
+    void setScratch(char* memory) noexcept { scratch = memory; }
+
+    // Not real-time safe. maximumVoices is the most voices queued between process() calls.
+    void prepare(const juce::dsp::ProcessSpec& spec, size_t maximumVoices)
+    {
+        entries.clear();
+        entries.reserve(maximumVoices);
+
+        ownedInterleaved = {};
+        if (scratch != nullptr)
+        {
+            layOutScratch(this, spec);
+        }
+        else
+        {
+            oversampler.setScratch(nullptr);
+            ladder.setScratch(nullptr);
+            ownedInterleaved.allocate(lanes * spec.maximumBlockSize);
+            interleaved = ownedInterleaved.get();
+        }
+
+        oversampler.prepare(lanes, spec.maximumBlockSize);
+        ladder.prepare(spec.sampleRate, lanes, spec.maximumBlockSize);
+    }
+
+    // Heap bytes owned, i.e. excluding shared scratch
+    size_t getMemoryUsage() const noexcept
+    {
+        return entries.capacity() * sizeof(Entry) + ownedInterleaved.getMemoryUsage()
+            + oversampler.getMemoryUsage() + ladder.getMemoryUsage();
+    }
+
+    // Filters every queued sub-block in place and empties the queue. Audio thread.
+    void process() noexcept
+    {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+        {
+            return a.factorLog2 != b.factorLog2 ? a.factorLog2 < b.factorLog2
+                                                : a.block.getNumSamples() < b.block.getNumSamples();
+        });
+
+        size_t numLanesUsed = 0;
+
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+        {
+            for (size_t channel = 0; channel < entry->block.getNumChannels(); ++channel)
+            {
+                group[numLanesUsed++] = { &*entry, channel };
+
+                if (numLanesUsed == lanes)
+                {
+                    processGroup(numLanesUsed);
+                    numLanesUsed = 0;
+                }
+            }
+
+            const auto next = entry + 1;
+            if (numLanesUsed > 0 && (next == entries.end() || next->factorLog2 != entry->factorLog2
+                                     || next->block.getNumSamples() != entry->block.getNumSamples()))
+            {
+                processGroup(numLanesUsed);
+                numLanesUsed = 0;
+            }
+        }
+
+        entries.clear();
+    }
+
+private:
+    friend class ChordialFilterVoice<SampleType>;
+
+    struct Entry
+    {
+        ChordialFilterVoice<SampleType>* voice;
+        juce::dsp::AudioBlock<SampleType> block;
+        int factorLog2;
+    };
+
+    struct Lane
+    {
+        Entry* entry;
+        size_t channel;
+    };
+
+    // Called by ChordialFilterVoice::process(context, bank), after it has set its cutoff and
+    // resonance for the block
+    void add(ChordialFilterVoice<SampleType>& voice, const juce::dsp::AudioBlock<SampleType>& block, int factorLog2) noexcept
+    {
+        jassert(entries.size() < entries.capacity());
+        entries.push_back({ &voice, block, factorLog2 });
+    }
+
+    // Measures the scratch with bank == nullptr, else hands it out to bank's buffers
+    static size_t layOutScratch(ChordialFilterBank* bank, const juce::dsp::ProcessSpec& spec) noexcept
+    {
+        ChordialScratchArena::Carver carver(bank != nullptr ? bank->scratch : nullptr);
+        auto* interleavedRegion = carver.take<SampleType>(lanes * spec.maximumBlockSize);
+        auto* oversamplerRegion = carver.take<char>(Oversampler::getScratchSize(spec.maximumBlockSize));
+        auto* filterRegion = carver.take<char>(Ladder::getScratchSize(lanes, spec.maximumBlockSize));
+
+        if (bank != nullptr)
+        {
+            bank->interleaved = interleavedRegion;
+            bank->oversampler.setScratch(oversamplerRegion);
+            bank->ladder.setScratch(filterRegion);
+        }
+
+        return carver.getNumBytesUsed();
+    }
+
+    void processGroup(size_t numLanesUsed) noexcept
+    {
+        const auto numSamples = group[0].entry->block.getNumSamples();
+        const auto factorLog2 = group[0].entry->factorLog2;
+
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            if (lane < numLanesUsed)
+            {
+                const auto* input = group[lane].entry->block.getChannelPointer(group[lane].channel);
+                for (size_t i = 0; i < numSamples; ++i)
+                    interleaved[i * lanes + lane] = input[i];
+
+                auto* voice = group[lane].entry->voice;
+                voice->chordialOversampler.useFactor(group[lane].channel / lanes, factorLog2);
+                Oversampler::copyLane(voice->chordialOversampler, group[lane].channel, oversampler, lane, factorLog2);
+                Ladder::copyLane(voice->chordialFilter, group[lane].channel, ladder, lane);
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    interleaved[i * lanes + lane] = static_cast<SampleType>(0.0);
+            }
+        }
+
+        auto* upsampled = oversampler.processUp(0, interleaved, numSamples, factorLog2);
+        ladder.processInterleaved(0, upsampled, numSamples << factorLog2);
+        oversampler.processDown(0, interleaved, numSamples, factorLog2);
+
+        for (size_t lane = 0; lane < numLanesUsed; ++lane)
+        {
+            auto* voice = group[lane].entry->voice;
+            Oversampler::copyLane(oversampler, lane, voice->chordialOversampler, group[lane].channel, factorLog2);
+            Ladder::copyLane(ladder, lane, voice->chordialFilter, group[lane].channel);
+
+            auto* output = group[lane].entry->block.getChannelPointer(group[lane].channel);
+            for (size_t i = 0; i < numSamples; ++i)
+                output[i] = interleaved[i * lanes + lane];
+        }
+    }
+
+    std::vector<Entry> entries;
+    Lane group[lanes] = {};
+    Oversampler oversampler;
+    Ladder ladder;
+    ChordialAlignedBuffer<SampleType> ownedInterleaved;
+    SampleType* interleaved{ nullptr };
+    char* scratch{ nullptr };
+};
+
+}
+}
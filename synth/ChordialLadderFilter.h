@@ -0,0 +1,403 @@
+/*
+  ==============================================================================
+
+    ChordialLadderFilter.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Ladder filter engine with one independent filter per lane. Same topology, modes,
+    drive law and 50 ms cutoff/resonance smoothing as juce::dsp::LadderFilter, but the
+    state, coefficients and smoothers of every lane live in structure-of-arrays form and
+    are processed ChordialSIMDRegister::SIMDNumElements lanes at a time.
+
+    A lane can carry a channel of one voice or a channel of any voice; process() maps
+    channel c of a block to lane c, processInterleaved() works directly on a group of
+    lanes laid out [sample][lane], and copyLane() moves a lane between filters, so lanes
+    of many filters can be gathered into one group (see ChordialFilterBank).
+
+    Approximations against the JUCE filter: tanh is a clamped [5/4] Pade approximant
+    (within 1.4e-3) and the cutoff transform exp(-2 pi fc / fs) is a short polynomial
+    (within 5e-5 relative), computed once per setCutoffFrequencyHz() call.
+*/
+template <typename SampleType>
+class ChordialLadderFilter
+{
+public:
+    using Register = ChordialSIMDRegister<SampleType>;
+    using Mode = typename juce::dsp::LadderFilter<SampleType>::Mode;
+
+    static constexpr size_t lanes = Register::SIMDNumElements;
+
+    ChordialLadderFilter()
+    {
+        setMode(Mode::LPF12);
+        setDrive(static_cast<SampleType>(1.2));
+    }
+
+    // Bytes of the working buffer process() interleaves into; processInterleaved() needs none
+    static size_t getScratchSize(size_t numLanes, size_t maximumBlockSize) noexcept
+    {
+        ChordialScratchArena::Carver carver;
+        carver.take<SampleType>(((numLanes + lanes - 1) / lanes) * lanes * maximumBlockSize);
+        return carver.getNumBytesUsed();
+    }
+
+    // Puts process()'s working buffer in memory of getScratchSize() bytes, aligned as a
+    // ChordialScratchArena, instead of allocating it. Not real-time safe, call before
+    // prepare(); nullptr goes back to allocating.
+    void setScratch(char* memory) noexcept { scratch = memory; }
+
+    // Not real-time safe
+    void prepare(double newSampleRate, size_t newNumLanes, size_t newMaximumBlockSize)
+    {
+        numLanes = newNumLanes;
+        numGroups = (numLanes + lanes - 1) / lanes;
+        maximumBlockSize = newMaximumBlockSize;
+        updateSampleRate(newSampleRate);
+
+        const auto paddedLanes = numGroups * lanes;
+        for (auto& s : state)
+            s.allocate(paddedLanes);
+
+        cutoffHz.allocate(paddedLanes);
+        std::fill(cutoffHz.get(), cutoffHz.get() + paddedLanes, defaultCutoff);
+
+        for (auto* smoother : { &cutoffTransform, &resonance })
+        {
+            smoother->current.allocate(paddedLanes);
+            smoother->target.allocate(paddedLanes);
+            smoother->step.allocate(paddedLanes);
+            smoother->countdown.allocate(paddedLanes);
+        }
+
+        ownedWorkBuffer = {};
+        if (scratch != nullptr)
+        {
+            workBuffer = ChordialScratchArena::Carver(scratch).take<SampleType>(paddedLanes * maximumBlockSize);
+        }
+        else
+        {
+            ownedWorkBuffer.allocate(paddedLanes * maximumBlockSize);
+            workBuffer = ownedWorkBuffer.get();
+        }
+
+        for (size_t lane = 0; lane < paddedLanes; ++lane)
+        {
+            cutoffTransform.setCurrentAndTarget(lane, transformCutoff(defaultCutoff * cutoffScaler));
+            resonance.setCurrentAndTarget(lane, scaleResonance(static_cast<SampleType>(0.0)));
+        }
+
+        reset();
+    }
+
+    // Real-time safe, e.g. for switching oversampling factor. Keeps the filter state and jumps
+    // each lane's cutoff straight to its last setting at the new rate; numSamples passed to
+    // process() must stay within the prepared maximum.
+    void setSampleRate(double newSampleRate) noexcept
+    {
+        updateSampleRate(newSampleRate);
+
+        for (size_t lane = 0; lane < numGroups * lanes; ++lane)
+            cutoffTransform.setCurrentAndTarget(lane, transformCutoff(cutoffHz.get()[lane] * cutoffScaler));
+    }
+
+    // Clears the filter state and jumps every smoother to its target
+    void reset()
+    {
+        for (auto& s : state)
+            s.clear();
+
+        for (size_t lane = 0; lane < numGroups * lanes; ++lane)
+        {
+            cutoffTransform.setCurrentAndTarget(lane, cutoffTransform.target.get()[lane]);
+            resonance.setCurrentAndTarget(lane, resonance.target.get()[lane]);
+        }
+    }
+
+    void resetLane(size_t lane)
+    {
+        jassert(lane < numLanes);
+
+        for (auto& s : state)
+            s.get()[lane] = static_cast<SampleType>(0.0);
+
+        cutoffTransform.setCurrentAndTarget(lane, cutoffTransform.target.get()[lane]);
+        resonance.setCurrentAndTarget(lane, resonance.target.get()[lane]);
+    }
+
+    size_t getNumLanes() const noexcept { return numLanes; }
+
+    // Copies the state, cutoff and smoothing of lane fromLane of from to lane toLane of to.
+    // Mode and drive are the filters' own.
+    static void copyLane(const ChordialLadderFilter& from, size_t fromLane, ChordialLadderFilter& to, size_t toLane) noexcept
+    {
+        jassert(fromLane < from.numGroups * lanes && toLane < to.numGroups * lanes);
+
+        for (size_t i = 0; i < numStates; ++i)
+            to.state[i].get()[toLane] = from.state[i].get()[fromLane];
+
+        to.cutoffHz.get()[toLane] = from.cutoffHz.get()[fromLane];
+        to.cutoffTransform.copyLane(from.cutoffTransform, fromLane, toLane);
+        to.resonance.copyLane(from.resonance, fromLane, toLane);
+    }
+
+    // Heap bytes owned, i.e. excluding shared scratch
+    size_t getMemoryUsage() const noexcept
+    {
+        size_t bytes = cutoffHz.getMemoryUsage() + ownedWorkBuffer.getMemoryUsage();
+        for (auto& s : state)
+            bytes += s.getMemoryUsage();
+        for (auto* smoother : { &cutoffTransform, &resonance })
+            bytes += smoother->current.getMemoryUsage() + smoother->target.getMemoryUsage()
+                   + smoother->step.getMemoryUsage() + smoother->countdown.getMemoryUsage();
+        return bytes;
+    }
+
+    void setMode(Mode newMode) noexcept
+    {
+        SampleType weights[numStates] = {};
+
+        switch (newMode)
+        {
+        case Mode::LPF12: weights[2] = 1; compensation = static_cast<SampleType>(0.5); break;
+        case Mode::HPF12: weights[0] = 1; weights[1] = -2; weights[2] = 1; compensation = 0; break;
+        case Mode::LPF24: weights[4] = 1; compensation = static_cast<SampleType>(0.5); break;
+        case Mode::HPF24: weights[0] = 1; weights[1] = -4; weights[2] = 6; weights[3] = -4; weights[4] = 1; compensation = 0; break;
+        default: jassertfalse; break;
+        }
+
+        for (size_t i = 0; i < numStates; ++i)
+            outputWeights[i] = weights[i] * static_cast<SampleType>(1.2);
+    }
+
+    void setDrive(SampleType newDrive) noexcept
+    {
+        drive = newDrive;
+        gain = std::pow(drive, static_cast<SampleType>(-2.642)) * static_cast<SampleType>(0.6103) + static_cast<SampleType>(0.3903);
+        drive2 = drive * static_cast<SampleType>(0.04) + static_cast<SampleType>(0.96);
+        gain2 = std::pow(drive2, static_cast<SampleType>(-2.642)) * static_cast<SampleType>(0.6103) + static_cast<SampleType>(0.3903);
+    }
+
+    void setCutoffFrequencyHz(size_t lane, SampleType hz) noexcept
+    {
+        jassert(lane < numLanes);
+        cutoffHz.get()[lane] = hz;
+        cutoffTransform.setTarget(lane, transformCutoff(hz * cutoffScaler), stepsToTarget);
+    }
+
+    void setResonance(size_t lane, SampleType value) noexcept
+    {
+        jassert(lane < numLanes);
+        resonance.setTarget(lane, scaleResonance(value), stepsToTarget);
+    }
+
+    // Filters the block in place, channel c on lane c. Lanes beyond the block's channels
+    // run on silence, so a filter processed this way should not be shared between users.
+    void process(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        const auto numChannels = block.getNumChannels();
+        const auto numSamples = block.getNumSamples();
+
+        jassert(numChannels <= numLanes);
+        jassert(numSamples <= maximumBlockSize);
+
+        for (size_t group = 0; group * lanes < numChannels; ++group)
+        {
+            simd::interleave(block, group * lanes, workBuffer);
+            processInterleaved(group, workBuffer, numSamples);
+            simd::deinterleave(workBuffer, group * lanes, block);
+        }
+    }
+
+    // Filters lanes [group * lanes, (group + 1) * lanes) in place, data laid out [sample][lane]
+    // and aligned for ChordialSIMDRegister
+    void processInterleaved(size_t group, SampleType* data, size_t numSamples) noexcept
+    {
+        jassert(group < numGroups);
+
+        const auto offset = group * lanes;
+        const auto zero = Register::expand(static_cast<SampleType>(0.0));
+        const auto one = Register::expand(static_cast<SampleType>(1.0));
+
+        const auto b0Scale = static_cast<SampleType>(0.76923076923);
+        const auto b1Scale = static_cast<SampleType>(0.23076923076);
+        const auto feedbackScale = static_cast<SampleType>(-4.0);
+
+        auto s0 = Register::fromRawArray(state[0].get() + offset);
+        auto s1 = Register::fromRawArray(state[1].get() + offset);
+        auto s2 = Register::fromRawArray(state[2].get() + offset);
+        auto s3 = Register::fromRawArray(state[3].get() + offset);
+        auto s4 = Register::fromRawArray(state[4].get() + offset);
+
+        auto a1 = Register::fromRawArray(cutoffTransform.current.get() + offset);
+        const auto a1Target = Register::fromRawArray(cutoffTransform.target.get() + offset);
+        const auto a1Step = Register::fromRawArray(cutoffTransform.step.get() + offset);
+        auto a1Remaining = Register::fromRawArray(cutoffTransform.countdown.get() + offset);
+
+        auto k = Register::fromRawArray(resonance.current.get() + offset);
+        const auto kTarget = Register::fromRawArray(resonance.target.get() + offset);
+        const auto kStep = Register::fromRawArray(resonance.step.get() + offset);
+        auto kRemaining = Register::fromRawArray(resonance.countdown.get() + offset);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            // LinearSmoothedValue::getNextValue() for every lane
+            auto smoothing = Register::greaterThan(a1Remaining, zero);
+            a1Remaining -= one & smoothing;
+            a1 += a1Step & smoothing;
+            a1 = simd::select(Register::lessThanOrEqual(a1Remaining, zero), a1Target, a1);
+
+            smoothing = Register::greaterThan(kRemaining, zero);
+            kRemaining -= one & smoothing;
+            k += kStep & smoothing;
+            k = simd::select(Register::lessThanOrEqual(kRemaining, zero), kTarget, k);
+
+            const auto g = one - a1;
+            const auto b0 = g * b0Scale;
+            const auto b1 = g * b1Scale;
+
+            const auto dx = fastTanh(Register::fromRawArray(data + i * lanes) * drive) * gain;
+            const auto a = dx + k * feedbackScale * (fastTanh(s4 * drive2) * gain2 - dx * compensation);
+            const auto b = b1 * s0 + a1 * s1 + b0 * a;
+            const auto c = b1 * s1 + a1 * s2 + b0 * b;
+            const auto d = b1 * s2 + a1 * s3 + b0 * c;
+            const auto e = b1 * s3 + a1 * s4 + b0 * d;
+
+            s0 = a; s1 = b; s2 = c; s3 = d; s4 = e;
+
+            const auto out = a * outputWeights[0] + b * outputWeights[1] + c * outputWeights[2]
+                + d * outputWeights[3] + e * outputWeights[4];
+            out.copyToRawArray(data + i * lanes);
+        }
+
+        s0.copyToRawArray(state[0].get() + offset);
+        s1.copyToRawArray(state[1].get() + offset);
+        s2.copyToRawArray(state[2].get() + offset);
+        s3.copyToRawArray(state[3].get() + offset);
+        s4.copyToRawArray(state[4].get() + offset);
+
+        a1.copyToRawArray(cutoffTransform.current.get() + offset);
+        a1Remaining.copyToRawArray(cutoffTransform.countdown.get() + offset);
+        k.copyToRawArray(resonance.current.get() + offset);
+        kRemaining.copyToRawArray(resonance.countdown.get() + offset);
+    }
+
+    // exp(-w) for w = 2 pi fc / fs, clamped to [0, pi]. Evaluated as (e^(-w/8))^8 with a
+    // fifth order Taylor series, which stays exact at low cutoffs where 1 - a1 is small.
+    static SampleType transformCutoff(SampleType w) noexcept
+    {
+        const auto x = -juce::jlimit(static_cast<SampleType>(0.0), juce::MathConstants<SampleType>::pi, w) * static_cast<SampleType>(0.125);
+        auto y = static_cast<SampleType>(1.0) + x * (static_cast<SampleType>(1.0) + x * (static_cast<SampleType>(1.0 / 2.0)
+            + x * (static_cast<SampleType>(1.0 / 6.0) + x * (static_cast<SampleType>(1.0 / 24.0) + x * static_cast<SampleType>(1.0 / 120.0)))));
+        y *= y;
+        y *= y;
+        return y * y;
+    }
+
+private:
+    static constexpr size_t numStates = 5;
+    static constexpr SampleType smoothingTimeInSeconds = static_cast<SampleType>(0.05);
+    static constexpr SampleType defaultCutoff = static_cast<SampleType>(200.0);
+
+    // One LinearSmoothedValue per lane
+    struct Smoother
+    {
+        void setCurrentAndTarget(size_t lane, SampleType value) noexcept
+        {
+            current.get()[lane] = target.get()[lane] = value;
+            countdown.get()[lane] = static_cast<SampleType>(0.0);
+        }
+
+        void setTarget(size_t lane, SampleType value, int steps) noexcept
+        {
+            if (target.get()[lane] == value)
+                return;
+
+            if (steps <= 0)
+            {
+                setCurrentAndTarget(lane, value);
+                return;
+            }
+
+            target.get()[lane] = value;
+            countdown.get()[lane] = static_cast<SampleType>(steps);
+            step.get()[lane] = (value - current.get()[lane]) / static_cast<SampleType>(steps);
+        }
+
+        void copyLane(const Smoother& from, size_t fromLane, size_t lane) noexcept
+        {
+            current.get()[lane] = from.current.get()[fromLane];
+            target.get()[lane] = from.target.get()[fromLane];
+            step.get()[lane] = from.step.get()[fromLane];
+            countdown.get()[lane] = from.countdown.get()[fromLane];
+        }
+
+        ChordialAlignedBuffer<SampleType> current;
+        ChordialAlignedBuffer<SampleType> target;
+        ChordialAlignedBuffer<SampleType> step;
+        ChordialAlignedBuffer<SampleType> countdown;
+    };
+
+    void updateSampleRate(double newSampleRate) noexcept
+    {
+        sampleRate = newSampleRate;
+        stepsToTarget = static_cast<int>(std::floor(smoothingTimeInSeconds * sampleRate));
+        cutoffScaler = static_cast<SampleType>(2.0 * juce::MathConstants<double>::pi / sampleRate);
+    }
+
+    static SampleType scaleResonance(SampleType value) noexcept
+    {
+        return juce::jmap(value, static_cast<SampleType>(0.1), static_cast<SampleType>(1.0));
+    }
+
+    // x(945 + 105x^2 + x^4) / (945 + 420x^2 + 15x^4), clamped where it reaches 1. SIMDRegister
+    // has no divide, so the denominator (in [945, 9184]) is inverted from a minimax linear
+    // guess with four Newton steps.
+    static Register fastTanh(Register x) noexcept
+    {
+        const auto limit = Register::expand(static_cast<SampleType>(3.6467385953));
+        const auto two = Register::expand(static_cast<SampleType>(2.0));
+
+        x = Register::max(Register::min(x, limit), Register::expand(static_cast<SampleType>(0.0)) - limit);
+
+        const auto x2 = x * x;
+        const auto numerator = x * ((x2 + static_cast<SampleType>(105.0)) * x2 + static_cast<SampleType>(945.0));
+        const auto denominator = (x2 * static_cast<SampleType>(15.0) + static_cast<SampleType>(420.0)) * x2 + static_cast<SampleType>(945.0);
+
+        auto inverse = Register::expand(static_cast<SampleType>(5.901619218e-4)) - denominator * static_cast<SampleType>(5.826867917e-8);
+        inverse = inverse * (two - denominator * inverse);
+        inverse = inverse * (two - denominator * inverse);
+        inverse = inverse * (two - denominator * inverse);
+        inverse = inverse * (two - denominator * inverse);
+
+        return numerator * inverse;
+    }
+
+    double sampleRate{ 44100.0 };
+    size_t numLanes{ 0 };
+    size_t numGroups{ 0 };
+    size_t maximumBlockSize{ 0 };
+    int stepsToTarget{ 0 };
+    SampleType cutoffScaler{ 0 };
+
+    SampleType drive{}, drive2{}, gain{}, gain2{}, compensation{};
+    SampleType outputWeights[numStates] = {};
+
+    ChordialAlignedBuffer<SampleType> state[numStates];
+    ChordialAlignedBuffer<SampleType> cutoffHz;
+    Smoother cutoffTransform;
+    Smoother resonance;
+    ChordialAlignedBuffer<SampleType> ownedWorkBuffer;
+    SampleType* workBuffer{ nullptr };
+    char* scratch{ nullptr };
+};
+
+}
+}
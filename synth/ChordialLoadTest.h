@@ -0,0 +1,291 @@
+/*
+  ==============================================================================
+
+    ChordialLoadTest.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Plays dense MIDI scenarios through a whole ChordialSynthesiser one host buffer at a
+    time, and times every renderNextBlock() call against the buffer's deadline.
+
+    Paced runs start each block on the host's schedule (sleeping in between, so caches
+    go cold the way they do behind a real audio callback) and resynchronise after an
+    overrun, like a host that drops a buffer. Unpaced runs render back to back.
+
+    Not for use on the audio thread.
+*/
+class ChordialLoadTest
+{
+public:
+    enum class Scenario
+    {
+        stackedChords, // eight note chords every half second, held then released into long tails
+        fastArpeggio,  // 50 ms notes over three octaves, far more tails than voices, so constant stealing
+        sustainedPads  // every voice held, all of them replaced every four seconds
+    };
+
+    struct Settings
+    {
+        double sampleRate{ 48000.0 };
+        int blockSize{ 128 };
+        int numVoices{ 32 };
+        int numRenderThreads{ 1 };
+        double seconds{ 10.0 };
+        // Share of each buffer period the synth may use; hosts and drivers need the rest
+        double deadlineFraction{ 1.0 };
+        bool paced{ true };
+    };
+
+    struct Report
+    {
+        std::string scenario;
+        int numVoices{ 0 };
+        int numBlocks{ 0 };
+        double deadlineMs{ 0.0 };
+        double meanMs{ 0.0 };
+        double p99Ms{ 0.0 };
+        double p999Ms{ 0.0 };
+        double worstMs{ 0.0 };
+        int deadlineMisses{ 0 };
+        // Mean number of voices rendering, from the synth's render stats
+        double meanActiveVoices{ 0.0 };
+
+        double getWorstLoad() const { return deadlineMs > 0.0 ? worstMs / deadlineMs : 0.0; }
+    };
+
+    static std::string getScenarioName(Scenario scenario)
+    {
+        switch (scenario)
+        {
+        case Scenario::stackedChords: return "stacked_chords";
+        case Scenario::fastArpeggio: return "fast_arpeggio";
+        case Scenario::sustainedPads: return "sustained_pads";
+        default: jassertfalse; return {};
+        }
+    }
+
+    static Report run(Scenario scenario, const Settings& settings)
+    {
+        ChordialOfflineRenderer::Settings hostSettings;
+        hostSettings.sampleRate = settings.sampleRate;
+        hostSettings.blockSize = settings.blockSize;
+        hostSettings.numVoices = settings.numVoices;
+        ChordialOfflineRenderer::Host host(hostSettings);
+
+        if (settings.numRenderThreads > 1)
+        {
+            host.synth.setNumberOfRenderThreads(settings.numRenderThreads);
+            host.synth.prepareToPlay(settings.sampleRate, settings.blockSize);
+        }
+
+        const auto totalSamples = static_cast<juce::int64>(settings.seconds * settings.sampleRate);
+        const auto events = makeEvents(scenario, settings, totalSamples);
+
+        const auto period = static_cast<double>(settings.blockSize) / settings.sampleRate;
+        const auto deadline = period * settings.deadlineFraction;
+        const auto ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+        const auto periodTicks = static_cast<juce::int64>(period * ticksPerSecond);
+
+        juce::AudioBuffer<float> buffer(2, settings.blockSize);
+        juce::MidiBuffer midi;
+        std::vector<double> times;
+        times.reserve(static_cast<size_t>(totalSamples / settings.blockSize + 1));
+
+        Report report;
+        report.scenario = getScenarioName(scenario);
+        report.numVoices = settings.numVoices;
+        report.deadlineMs = deadline * 1000.0;
+
+        const auto statsBefore = host.synth.getRenderStats();
+        size_t event = 0;
+        auto nextStart = juce::Time::getHighResolutionTicks();
+
+        for (juce::int64 position = 0; position < totalSamples; position += settings.blockSize)
+        {
+            midi.clear();
+            for (; event < events.size() && events[event].first < position + settings.blockSize; ++event)
+                midi.addEvent(events[event].second, static_cast<int>(events[event].first - position));
+
+            if (settings.paced)
+                waitUntil(nextStart);
+
+            buffer.clear();
+            const auto start = juce::Time::getHighResolutionTicks();
+            host.synth.renderNextBlock(buffer, midi, 0, settings.blockSize);
+            const auto end = juce::Time::getHighResolutionTicks();
+
+            const auto seconds = static_cast<double>(end - start) / ticksPerSecond;
+            times.push_back(seconds * 1000.0);
+            if (seconds > deadline)
+                ++report.deadlineMisses;
+
+            // A host that overran drops the buffer and starts again from now
+            nextStart += periodTicks;
+            if (end > nextStart)
+                nextStart = end;
+        }
+
+        const auto statsAfter = host.synth.getRenderStats();
+        const auto rendered = static_cast<double>(statsAfter.renderedVoiceBlocks - statsBefore.renderedVoiceBlocks);
+        const auto skipped = static_cast<double>(statsAfter.skippedVoiceBlocks - statsBefore.skippedVoiceBlocks);
+        if (rendered + skipped > 0.0)
+            report.meanActiveVoices = settings.numVoices * rendered / (rendered + skipped);
+
+        report.numBlocks = static_cast<int>(times.size());
+        if (!times.empty())
+        {
+            report.meanMs = std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size());
+            std::sort(times.begin(), times.end());
+            report.p99Ms = getPercentile(times, 0.99);
+            report.p999Ms = getPercentile(times, 0.999);
+            report.worstMs = times.back();
+        }
+
+        return report;
+    }
+
+    // The largest voice count, up to maximumVoices, that plays the scenario without a deadline
+    // miss: doubles from 8 until a run misses, then bisects. 0 if even 8 voices miss.
+    static int findPolyphonyBudget(Scenario scenario, Settings settings, int maximumVoices = 1024)
+    {
+        auto passes = [&](int numVoices)
+        {
+            settings.numVoices = numVoices;
+            return run(scenario, settings).deadlineMisses == 0;
+        };
+
+        auto good = 0;
+        auto bad = maximumVoices + 1;
+
+        for (auto numVoices = 8; numVoices <= maximumVoices; numVoices *= 2)
+        {
+            if (!passes(numVoices))
+            {
+                bad = numVoices;
+                break;
+            }
+            good = numVoices;
+        }
+
+        if (good == 0)
+            return 0;
+
+        bad = juce::jmin(bad, maximumVoices + 1);
+        while (bad - good > 1)
+        {
+            const auto middle = (good + bad) / 2;
+            if (passes(middle))
+                good = middle;
+            else
+                bad = middle;
+        }
+
+        return good;
+    }
+
+private:
+    using Events = std::vector<std::pair<juce::int64, juce::MidiMessage>>;
+
+    // Notes go on the channel of their slot so a later note on the same key doesn't steal
+    // the earlier one's voice before the allocator gets a say
+    static Events makeEvents(Scenario scenario, const Settings& settings, juce::int64 totalSamples)
+    {
+        Events events;
+        juce::Random random(0x43686f72);
+        const auto sampleRate = settings.sampleRate;
+        auto at = [sampleRate](double seconds) { return static_cast<juce::int64>(seconds * sampleRate); };
+
+        auto addNote = [&events](juce::int64 start, juce::int64 end, int channel, int note, float velocity)
+        {
+            events.push_back({ start, juce::MidiMessage::noteOn(channel, note, velocity) });
+            events.push_back({ end, juce::MidiMessage::noteOff(channel, note) });
+        };
+
+        switch (scenario)
+        {
+        case Scenario::stackedChords:
+        {
+            const int intervals[] = { 0, 4, 7, 11, 12, 16, 19, 24 };
+            auto chord = 0;
+            for (auto start = 0.0; at(start) < totalSamples; start += 0.5, ++chord)
+            {
+                const auto root = 36 + random.nextInt(24);
+                for (const auto interval : intervals)
+                    addNote(at(start), at(start + 0.45), 1 + chord % 16, root + interval, 0.5f + 0.5f * random.nextFloat());
+            }
+            break;
+        }
+
+        case Scenario::fastArpeggio:
+        {
+            const int pattern[] = { 0, 3, 7, 10, 12, 15, 19, 22, 24, 27, 31, 34, 36, 34, 31, 27, 24, 22, 19, 15, 12, 10, 7, 3 };
+            const auto numSteps = static_cast<int>(sizeof(pattern) / sizeof(pattern[0]));
+            auto step = 0;
+            auto root = 40;
+            for (auto start = 0.0; at(start) < totalSamples; start += 0.05, ++step)
+            {
+                if (step % numSteps == 0)
+                    root = 36 + random.nextInt(12);
+                addNote(at(start), at(start + 0.04), 1 + step % 16, root + pattern[step % numSteps], 0.6f + 0.4f * random.nextFloat());
+            }
+            break;
+        }
+
+        case Scenario::sustainedPads:
+        {
+            auto pad = 0;
+            for (auto start = 0.0; at(start) < totalSamples; start += 4.0, ++pad)
+            {
+                const auto root = 36 + random.nextInt(12);
+                for (int voice = 0; voice < settings.numVoices; ++voice)
+                    addNote(at(start), at(start + 4.0) - 1, 1 + (voice / 48 + pad) % 16, root + voice % 48, 0.7f);
+            }
+            break;
+        }
+
+        default:
+            jassertfalse;
+            break;
+        }
+
+        // Note offs before note ons at the same sample, so back to back notes retrigger
+        std::stable_sort(events.begin(), events.end(), [](const Events::value_type& a, const Events::value_type& b)
+        {
+            if (a.first != b.first)
+                return a.first < b.first;
+            return a.second.isNoteOff() && !b.second.isNoteOff();
+        });
+
+        return events;
+    }
+
+    static double getPercentile(const std::vector<double>& sortedTimes, double fraction)
+    {
+        const auto index = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sortedTimes.size()))) - 1;
+        return sortedTimes[juce::jmin(index, sortedTimes.size() - 1)];
+    }
+
+    // Sleeps most of the way, then yields for the last millisecond to land on time
+    static void waitUntil(juce::int64 ticks)
+    {
+        const auto ticksPerMillisecond = juce::Time::getHighResolutionTicksPerSecond() / 1000;
+
+        for (auto now = juce::Time::getHighResolutionTicks(); now < ticks; now = juce::Time::getHighResolutionTicks())
+        {
+            if (ticks - now > 2 * ticksPerMillisecond)
+                juce::Thread::sleep(1);
+            else
+                juce::Thread::yield();
+        }
+    }
+};
+
+}
+}
@@ -14,25 +14,243 @@ namespace chordial
 namespace synth
 {
 
+/*  Holds the routing rows and compiles them into a flat table of integer slots.
+
+    Rows are edited on the message thread. Every edit compiles a new table and
+    publishes it with an atomic pointer swap; the audio thread(s) pick it up on the
+    next process() without locking. Readers count themselves in one of two phases; an
+    edit that finds the phase new readers left behind empty frees every table superseded
+    before that phase ended and sends new readers there, so overlapping readers on many
+    threads do not hold superseded tables back. At most maxTables are kept.
+*/
 class ChordialModMatrixCore
 {
+public:
+    // Control rate rows move one value per control tick; audio rate rows are summed
+    // sample by sample into destinations that provide a ChordialModulationBuffer
+    enum class Rate { control, audio };
+
+private:
     struct MatrixRow
     {
-        MatrixRow(const std::string& source, const std::string& destination, bool enabled) : source(source), destination(destination), enabled(enabled) {}
-        const std::string source, destination;
+        MatrixRow(const std::string& source, const std::string& destination, bool enabled, float depth, Rate rate)
+            : source(source), destination(destination), enabled(enabled), depth(depth), rate(rate) {}
+        std::string source, destination;
         bool enabled;
+        float depth;
+        Rate rate;
     };
 
 public:
-    void addRow(const std::string& source, const std::string& destination, bool enabled)
+    static constexpr int maxSlots = 64;
+    // Most tables kept, the current one included, before an edit waits for readers
+    static constexpr size_t maxTables = 8;
+
+    struct Route
+    {
+        int source;
+        int destination;
+        float depth;
+    };
+
+    struct Table
+    {
+        std::vector<Route> routes;              // enabled control rate rows
+        std::vector<Route> audioRoutes;         // enabled audio rate rows
+        std::vector<int> destinationsToClear;   // every row's destination, deduplicated
+        std::vector<int> audioDestinations;     // audio rate routes' destinations, deduplicated
+    };
+
+    // Pins the current table for the lifetime of the reader. Real-time safe.
+    class ScopedTableReader
+    {
+    public:
+        explicit ScopedTableReader(ChordialModMatrixCore& matrixCore)
+            : core(matrixCore), phase(core.phase.load())
+        {
+            core.readers[phase].fetch_add(1);
+            table = core.current.load();
+        }
+
+        ~ScopedTableReader()
+        {
+            core.readers[phase].fetch_sub(1);
+        }
+
+        const Table& getTable() const noexcept { return *table; }
+
+    private:
+        ChordialModMatrixCore& core;
+        const int phase;
+        const Table* table;
+    };
+
+    ChordialModMatrixCore()
+    {
+        publish();
+    }
+
+    // Slots are assigned on first use of a name and never change; -1 once maxSlots names
+    // are in use
+    int getSourceSlot(const std::string& name)
+    {
+        const juce::ScopedLock sl(writeLock);
+        return getSlot(sourceSlots, name);
+    }
+
+    int getDestinationSlot(const std::string& name)
+    {
+        const juce::ScopedLock sl(writeLock);
+        return getSlot(destinationSlots, name);
+    }
+
+    void addRow(const std::string& source, const std::string& destination, bool enabled, float depth = 1.0f, Rate rate = Rate::control)
+    {
+        const juce::ScopedLock sl(writeLock);
+        rows.emplace_back(source, destination, enabled, depth, rate);
+        publish();
+    }
+
+    void setRowEnabled(size_t index, bool enabled)
+    {
+        const juce::ScopedLock sl(writeLock);
+        jassert(index < rows.size());
+        rows[index].enabled = enabled;
+        publish();
+    }
+
+    void setRowDepth(size_t index, float depth)
     {
-        rows.emplace_back(source, destination, enabled);
+        const juce::ScopedLock sl(writeLock);
+        jassert(index < rows.size());
+        rows[index].depth = depth;
+        publish();
     }
 
-    const std::vector<MatrixRow>& getRows() { return rows; }
+    void setRowRate(size_t index, Rate rate)
+    {
+        const juce::ScopedLock sl(writeLock);
+        jassert(index < rows.size());
+        rows[index].rate = rate;
+        publish();
+    }
+
+    void removeRow(size_t index)
+    {
+        const juce::ScopedLock sl(writeLock);
+        jassert(index < rows.size());
+        rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(index));
+        publish();
+    }
+
+    // A snapshot, as an edit on another thread may change the rows. Not real-time safe.
+    std::vector<MatrixRow> getRows() const
+    {
+        const juce::ScopedLock sl(writeLock);
+        return rows;
+    }
 
 private:
+    static int getSlot(std::unordered_map<std::string, int>& slots, const std::string& name)
+    {
+        const auto existing = slots.find(name);
+        if (existing != slots.end())
+            return existing->second;
+
+        const auto slot = static_cast<int>(slots.size());
+        if (slot >= maxSlots)
+        {
+            jassertfalse;
+            return -1;
+        }
+
+        slots[name] = slot;
+        return slot;
+    }
+
+    static void addUnique(std::vector<int>& slots, int slot)
+    {
+        if (std::find(slots.begin(), slots.end(), slot) == slots.end())
+            slots.push_back(slot);
+    }
+
+    void publish()
+    {
+        auto table = std::make_unique<Table>();
+
+        for (const auto& row : rows)
+        {
+            const auto source = getSlot(sourceSlots, row.source);
+            const auto destination = getSlot(destinationSlots, row.destination);
+
+            // A name past maxSlots has nowhere to read or write, so its rows do nothing
+            if (source < 0 || destination < 0)
+                continue;
+
+            addUnique(table->destinationsToClear, destination);
+
+            if (!row.enabled)
+                continue;
+
+            if (row.rate == Rate::audio)
+            {
+                table->audioRoutes.push_back({ source, destination, row.depth });
+                addUnique(table->audioDestinations, destination);
+            }
+            else
+            {
+                table->routes.push_back({ source, destination, row.depth });
+            }
+        }
+
+        current.store(table.get());
+        tables.push_back(std::move(table));
+
+        // Readers still counted in the other phase are the only ones that can hold a table
+        // superseded before the last flip. Once they have left, free those tables and flip,
+        // so readers arriving from now on drain the phase in use until now. Past maxTables
+        // the edit waits for them, which takes no longer than the readers' process() calls.
+        const auto otherPhase = 1 - phase.load();
+        while (tables.size() > maxTables && readers[otherPhase].load() > 0)
+            juce::Thread::yield();
+
+        if (readers[otherPhase].load() == 0)
+        {
+            tables.erase(tables.begin(), tables.begin() + static_cast<std::ptrdiff_t>(numTablesBeforeFlip));
+            numTablesBeforeFlip = tables.size() - 1;
+            phase.store(otherPhase);
+        }
+    }
+
     std::vector<MatrixRow> rows;
+    std::unordered_map<std::string, int> sourceSlots;
+    std::unordered_map<std::string, int> destinationSlots;
+    juce::CriticalSection writeLock;
+
+    std::vector<std::unique_ptr<Table>> tables;
+    // tables[0, numTablesBeforeFlip) were superseded before the last phase flip
+    size_t numTablesBeforeFlip{ 0 };
+    std::atomic<const Table*> current{ nullptr };
+    std::atomic<int> phase{ 0 };
+    std::atomic<int> readers[2] = { { 0 }, { 0 } };
+};
+
+// Per-sample modulation signal. active is set by the matrix for every block in which
+// audio rate routes drive the buffer; otherwise the owner uses its scalar input.
+template <typename SampleType>
+struct ChordialModulationBuffer
+{
+    void allocate(size_t maximumBlockSize)
+    {
+        data.allocate(maximumBlockSize, true);
+        size = maximumBlockSize;
+    }
+
+    size_t getMemoryUsage() const noexcept { return size * sizeof(SampleType); }
+
+    juce::HeapBlock<SampleType> data;
+    size_t size{ 0 };
+    bool active{ false };
 };
 
 template <typename SampleType>
@@ -50,46 +268,224 @@ public:
         SampleType* const valPtr;
     };
 
+    ChordialModMatrix()
+    {
+        resolveSlots();
+    }
+
     void setCore(std::shared_ptr<ChordialModMatrixCore> matrixCore)
     {
         core = matrixCore;
+        resolveSlots();
     }
     void addModSource(ModMatrixSource source)
     {
-        modSources[source.name] = source.valPtr;
+        namedSources.push_back(source);
+        resolveSlots();
     }
 
     void addModDestination(ModMatrixDestination destination)
     {
-        modDestinations[destination.name] = destination.valPtr;
+        namedDestinations.push_back(destination);
+        resolveSlots();
+    }
+
+    // Lets audio rate rows write sample by sample into buffer. The destination must also be
+    // registered with addModDestination for its control rate value.
+    void addAudioRateDestination(const std::string& name, ChordialModulationBuffer<SampleType>* buffer)
+    {
+        namedAudioDestinations.push_back({ name, buffer });
+        resolveSlots();
+    }
+
+    // A source with its own per-sample signal. Sources without one are interpolated linearly
+    // across each control period on audio rate rows, i.e. they lag by one period but don't step.
+    void addAudioRateSource(const std::string& name, ChordialModulationBuffer<SampleType>* buffer)
+    {
+        namedAudioSources.push_back({ name, buffer });
+        resolveSlots();
+    }
+
+    void prepare(size_t maximumBlockSize, int samplesPerControlSignal)
+    {
+        rampBuffer.allocate(maximumBlockSize, true);
+        rampBufferSize = maximumBlockSize;
+        setSamplesPerControlSignal(samplesPerControlSignal);
     }
 
+    // Heap bytes owned: the ramp buffer and the name tables
+    size_t getMemoryUsage() const noexcept
+    {
+        return rampBufferSize * sizeof(SampleType)
+             + namedSources.capacity() * sizeof(ModMatrixSource)
+             + namedDestinations.capacity() * sizeof(ModMatrixDestination)
+             + (namedAudioSources.capacity() + namedAudioDestinations.capacity()) * sizeof(NamedBuffer)
+             + connectedSources.capacity() * sizeof(size_t);
+    }
+
+    // Length of the control period starting at the next process(), for unevenly spaced ticks
+    void setSamplesPerControlSignal(int samplesPerControlSignal)
+    {
+        rampLength = juce::jmax(1, samplesPerControlSignal);
+    }
+
+    // Call once per control tick, after the sources have been updated
     void process()
     {
-        
+
         if (core == nullptr)
             return;
 
-        clearDestinations();
-        for (const auto& row : core->getRows())
-            if (row.enabled)
-                *modDestinations[row.destination] += *modSources[row.source];
+        const ChordialModMatrixCore::ScopedTableReader reader(*core);
+        const auto& table = reader.getTable();
+
+        for (const auto destination : table.destinationsToClear)
+            *destinations[static_cast<size_t>(destination)] = static_cast<SampleType>(0.0);
+
+        for (const auto& route : table.routes)
+            *destinations[static_cast<size_t>(route.destination)] += *sources[static_cast<size_t>(route.source)] * static_cast<SampleType>(route.depth);
+
+        // Audio rate rows into destinations without a buffer run at control rate
+        for (const auto& route : table.audioRoutes)
+            if (destinationBuffers[static_cast<size_t>(route.destination)] == nullptr)
+                *destinations[static_cast<size_t>(route.destination)] += *sources[static_cast<size_t>(route.source)] * static_cast<SampleType>(route.depth);
+
+        for (const auto slot : connectedSources)
+        {
+            rampStart[slot] = rampEnd[slot];
+            rampEnd[slot] = *sources[slot];
+        }
+        rampPosition = 0;
+    }
+
+    // Call for every processed block, after process() on control ticks. Fills each audio
+    // rate destination buffer with its control rate value plus the audio rate routes.
+    void processAudioRate(size_t numSamples)
+    {
+        if (core == nullptr || numSamples == 0)
+            return;
+
+        const ChordialModMatrixCore::ScopedTableReader reader(*core);
+        const auto& table = reader.getTable();
+        const auto count = static_cast<int>(numSamples);
+
+        for (auto& destination : namedAudioDestinations)
+            destination.buffer->active = false;
+
+        for (const auto slot : table.audioDestinations)
+        {
+            if (auto* buffer = destinationBuffers[static_cast<size_t>(slot)])
+            {
+                juce::FloatVectorOperations::fill(buffer->data.get(), *destinations[static_cast<size_t>(slot)], count);
+                buffer->active = true;
+            }
+        }
+
+        for (const auto& route : table.audioRoutes)
+        {
+            auto* destination = destinationBuffers[static_cast<size_t>(route.destination)];
+            if (destination == nullptr)
+                continue;
+
+            const auto* source = getSourceSignal(static_cast<size_t>(route.source), numSamples);
+            juce::FloatVectorOperations::addWithMultiply(destination->data.get(), source, static_cast<SampleType>(route.depth), count);
+        }
+
+        rampPosition += numSamples;
     }
 
 private:
+    struct NamedBuffer
+    {
+        std::string name;
+        ChordialModulationBuffer<SampleType>* buffer;
+    };
+
+    const SampleType* getSourceSignal(size_t slot, size_t numSamples)
+    {
+        if (auto* buffer = sourceBuffers[slot])
+            if (buffer->active)
+                return buffer->data.get();
+
+        // Reaches the latest tick's value at the end of the control period
+        const auto start = rampStart[slot];
+        const auto increment = (rampEnd[slot] - start) / static_cast<SampleType>(rampLength);
+        auto* ramp = rampBuffer.get();
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto position = static_cast<SampleType>(juce::jmin(rampPosition + i + 1, static_cast<size_t>(rampLength)));
+            ramp[i] = start + increment * position;
+        }
 
-    void clearDestinations()
+        return ramp;
+    }
+
+    // Slots this matrix has no pointer for read zero and write to a scratch value
+    void resolveSlots()
     {
-        for (const auto& row : core->getRows())
+        sources.fill(&unconnectedSource);
+        destinations.fill(&unconnectedDestination);
+        sourceBuffers.fill(nullptr);
+        destinationBuffers.fill(nullptr);
+        connectedSources.clear();
+
+        if (core == nullptr)
+            return;
+
+        // Names the core has no slot for stay unconnected
+        for (const auto& source : namedSources)
+        {
+            const auto slot = core->getSourceSlot(source.name);
+            if (slot < 0)
+                continue;
+            sources[static_cast<size_t>(slot)] = source.valPtr;
+            connectedSources.push_back(static_cast<size_t>(slot));
+        }
+
+        for (const auto& destination : namedDestinations)
         {
-            *modDestinations[row.destination] = static_cast<SampleType>(0.0);
+            const auto slot = core->getDestinationSlot(destination.name);
+            if (slot >= 0)
+                destinations[static_cast<size_t>(slot)] = destination.valPtr;
+        }
+
+        for (const auto& source : namedAudioSources)
+        {
+            const auto slot = core->getSourceSlot(source.name);
+            if (slot >= 0)
+                sourceBuffers[static_cast<size_t>(slot)] = source.buffer;
+        }
+
+        for (const auto& destination : namedAudioDestinations)
+        {
+            const auto slot = core->getDestinationSlot(destination.name);
+            if (slot >= 0)
+                destinationBuffers[static_cast<size_t>(slot)] = destination.buffer;
         }
     }
 
     std::shared_ptr<ChordialModMatrixCore> core{ nullptr };
-    std::unordered_map<std::string, SampleType*> modSources;
-    std::unordered_map<std::string, SampleType*> modDestinations;
+    std::vector<ModMatrixSource> namedSources;
+    std::vector<ModMatrixDestination> namedDestinations;
+    std::vector<NamedBuffer> namedAudioSources;
+    std::vector<NamedBuffer> namedAudioDestinations;
+    std::vector<size_t> connectedSources;
+
+    std::array<SampleType*, ChordialModMatrixCore::maxSlots> sources;
+    std::array<SampleType*, ChordialModMatrixCore::maxSlots> destinations;
+    std::array<ChordialModulationBuffer<SampleType>*, ChordialModMatrixCore::maxSlots> sourceBuffers;
+    std::array<ChordialModulationBuffer<SampleType>*, ChordialModMatrixCore::maxSlots> destinationBuffers;
+    SampleType unconnectedSource{ static_cast<SampleType>(0.0) };
+    SampleType unconnectedDestination{ static_cast<SampleType>(0.0) };
+
+    std::array<SampleType, ChordialModMatrixCore::maxSlots> rampStart{};
+    std::array<SampleType, ChordialModMatrixCore::maxSlots> rampEnd{};
+    juce::HeapBlock<SampleType> rampBuffer;
+    size_t rampBufferSize{ 0 };
+    size_t rampPosition{ 0 };
+    int rampLength{ 1 };
 };
 
 }
-}
\ No newline at end of file
+}
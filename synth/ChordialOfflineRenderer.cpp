@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    ChordialOfflineRenderer.cpp
+
+  ==============================================================================
+*/
+
+namespace chordial
+{
+namespace synth
+{
+
+class ChordialOfflineRenderer::Worker : public juce::Thread
+{
+public:
+    Worker(const ChordialOfflineRenderer& owner, const std::vector<Job>& jobsToRender,
+           std::vector<Result>& jobResults, std::atomic<size_t>& nextJob)
+        : juce::Thread("Chordial offline render"), renderer(owner), jobs(jobsToRender), results(jobResults), next(nextJob)
+    {
+    }
+
+    void run() override
+    {
+        for (auto job = next.fetch_add(1); job < jobs.size() && !threadShouldExit(); job = next.fetch_add(1))
+            results[job] = renderer.render(jobs[job]);
+    }
+
+private:
+    const ChordialOfflineRenderer& renderer;
+    const std::vector<Job>& jobs;
+    std::vector<Result>& results;
+    std::atomic<size_t>& next;
+};
+
+ChordialOfflineRenderer::Result ChordialOfflineRenderer::render(const Job& job) const
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    Result result;
+    result.outputFile = job.outputFile;
+
+    auto fail = [&result](const juce::String& message)
+    {
+        result.errorMessage = message;
+        return result;
+    };
+
+    juce::MidiFile midiFile;
+    {
+        juce::FileInputStream input(job.midiFile);
+        if (!input.openedOk() || !midiFile.readFrom(input))
+            return fail("Couldn't read MIDI file " + job.midiFile.getFullPathName());
+    }
+    midiFile.convertTimestampTicksToSeconds();
+
+    juce::MidiMessageSequence sequence;
+    for (int track = 0; track < midiFile.getNumTracks(); ++track)
+        sequence.addSequence(*midiFile.getTrack(track), 0.0);
+
+    Host host(settings);
+    if (job.presetFile != juce::File() && !host.loadPreset(job.presetFile, result.errorMessage))
+        return result;
+
+    job.outputFile.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(job.outputFile);
+    if (!stream->openedOk())
+        return fail("Couldn't open " + job.outputFile.getFullPathName() + " for writing");
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), settings.sampleRate, 2,
+                                                                        settings.bitsPerSample, {}, 0));
+    if (writer == nullptr)
+        return fail("Couldn't create a " + juce::String(settings.bitsPerSample) + " bit WAV writer");
+    stream.release();
+
+    const auto sampleRate = settings.sampleRate;
+    auto toSamples = [sampleRate](double seconds) { return static_cast<juce::int64>(seconds * sampleRate + 0.5); };
+
+    const auto numEvents = sequence.getNumEvents();
+    const auto endOfEvents = toSamples(sequence.getEndTime());
+    const auto maximumLength = endOfEvents + toSamples(settings.maximumTailSeconds);
+
+    juce::AudioBuffer<float> buffer(2, settings.blockSize);
+    juce::MidiBuffer midi;
+    juce::int64 position = 0;
+    int event = 0;
+
+    while (position < maximumLength)
+    {
+        const auto numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(settings.blockSize), maximumLength - position));
+
+        midi.clear();
+        for (; event < numEvents; ++event)
+        {
+            const auto& message = sequence.getEventPointer(event)->message;
+            const auto samplePosition = toSamples(message.getTimeStamp());
+            if (samplePosition >= position + numSamples)
+                break;
+
+            if (!message.isMetaEvent())
+                midi.addEvent(message, static_cast<int>(juce::jmax(static_cast<juce::int64>(0), samplePosition - position)));
+        }
+
+        buffer.clear();
+        host.synth.renderNextBlock(buffer, midi, 0, numSamples);
+        writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        position += numSamples;
+
+        if (event == numEvents && position >= endOfEvents && !host.isSounding())
+            break;
+    }
+
+    writer.reset();
+
+    result.succeeded = true;
+    result.audioSeconds = static_cast<double>(position) / sampleRate;
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    return result;
+}
+
+std::vector<ChordialOfflineRenderer::Result> ChordialOfflineRenderer::renderAll(const std::vector<Job>& jobs, int numWorkers) const
+{
+    std::vector<Result> results(jobs.size());
+    if (jobs.empty())
+        return results;
+
+    if (numWorkers <= 0)
+        numWorkers = juce::SystemStats::getNumCpus();
+    numWorkers = juce::jmin(numWorkers, static_cast<int>(jobs.size()));
+
+    std::atomic<size_t> nextJob{ 0 };
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 1; i < numWorkers; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(*this, jobs, results, nextJob));
+        workers.back()->startThread();
+    }
+
+    // The calling thread is a worker too
+    Worker(*this, jobs, results, nextJob).run();
+
+    for (auto& worker : workers)
+        worker->waitForThreadToExit(-1);
+
+    return results;
+}
+
+}
+}
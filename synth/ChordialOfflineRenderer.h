@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    ChordialOfflineRenderer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Renders Standard MIDI Files through ChordialSynthesiser to WAV files, as fast as the
+    machine allows and without an audio device.
+
+    Every job gets its own synthesiser, hosted by a minimal AudioProcessor that owns the
+    AudioProcessorValueTreeState. A preset is that state as XML (what a plugin's
+    getStateInformation() writes): PARAM children with id and value attributes.
+    renderAll() spreads jobs across worker threads, so each worker has exactly one
+    synthesiser alive at a time.
+
+    Not for use on the audio thread.
+*/
+class ChordialOfflineRenderer
+{
+public:
+    struct Settings
+    {
+        double sampleRate{ 44100.0 };
+        // Voices split blocks at the control rate anyway, so large blocks only cut the
+        // per-block overhead; 2048 keeps each voice's scratch buffer in L2
+        int blockSize{ 2048 };
+        int numVoices{ 8 };
+        int bitsPerSample{ 24 };
+        // Rendering continues after the last MIDI event until every voice has finished, or
+        // for at most this long
+        double maximumTailSeconds{ 10.0 };
+    };
+
+    struct Job
+    {
+        juce::File midiFile;
+        juce::File presetFile; // optional
+        juce::File outputFile;
+    };
+
+    struct Result
+    {
+        juce::File outputFile;
+        bool succeeded{ false };
+        juce::String errorMessage;
+        double audioSeconds{ 0.0 };
+        double renderSeconds{ 0.0 };
+
+        double getRealtimeFactor() const { return renderSeconds > 0.0 ? audioSeconds / renderSeconds : 0.0; }
+    };
+
+    ChordialOfflineRenderer() = default;
+    explicit ChordialOfflineRenderer(const Settings& renderSettings) : settings(renderSettings) {}
+
+    const Settings& getSettings() const noexcept { return settings; }
+
+    // Renders one job on the calling thread
+    Result render(const Job& job) const;
+
+    // Renders every job on numWorkers threads (the calling thread included), 0 for one per
+    // CPU. Results are in job order.
+    std::vector<Result> renderAll(const std::vector<Job>& jobs, int numWorkers = 0) const;
+
+    // Just enough of a plugin to own the parameter state ChordialSynthesiser registers with.
+    // Also hosts the whole-synth cases of ChordialBenchmark.
+    class Host : public juce::AudioProcessor
+    {
+    public:
+        explicit Host(const Settings& settings) : state(*this, nullptr), synth(state)
+        {
+            state.state = juce::ValueTree(juce::Identifier("ChordialOfflineRenderer"));
+            synth.setNumberOfVoices(settings.numVoices);
+            synth.prepareToPlay(settings.sampleRate, settings.blockSize);
+        }
+
+        bool loadPreset(const juce::File& file, juce::String& errorMessage)
+        {
+            std::unique_ptr<juce::XmlElement> xml(juce::XmlDocument::parse(file));
+            if (xml == nullptr)
+            {
+                errorMessage = "Couldn't parse preset " + file.getFullPathName();
+                return false;
+            }
+
+            for (auto* child = xml->getFirstChildElement(); child != nullptr; child = child->getNextElement())
+            {
+                if (!child->hasTagName("PARAM"))
+                    continue;
+
+                const auto id = child->getStringAttribute("id");
+                if (auto* parameter = state.getParameter(id))
+                {
+                    const auto value = static_cast<float>(child->getDoubleAttribute("value"));
+                    parameter->setValueNotifyingHost(state.getParameterRange(id).convertTo0to1(value));
+                }
+            }
+
+            return true;
+        }
+
+        bool isSounding()
+        {
+            for (int i = 0; i < synth.getNumVoices(); ++i)
+                if (synth.getVoice(i)->isVoiceActive())
+                    return true;
+
+            return false;
+        }
+
+        const juce::String getName() const override { return "ChordialOfflineRenderer"; }
+        void prepareToPlay(double, int) override {}
+        void releaseResources() override {}
+        void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override {}
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return true; }
+        bool producesMidi() const override { return false; }
+        juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram(int) override {}
+        const juce::String getProgramName(int) override { return {}; }
+        void changeProgramName(int, const juce::String&) override {}
+        void getStateInformation(juce::MemoryBlock&) override {}
+        void setStateInformation(const void*, int) override {}
+
+        juce::AudioProcessorValueTreeState state;
+        ChordialSynthesiser synth;
+    };
+
+private:
+    class Worker;
+
+    Settings settings;
+};
+
+}
+}
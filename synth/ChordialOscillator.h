@@ -17,11 +17,21 @@ namespace synth
 template <typename FloatType>
 class ChordialOscillatorVoice;
 
+template <typename FloatType>
+class ChordialOscillatorBank;
+
+template <typename FloatType>
+class ChordialUnisonOscillator;
+
+// Settings shared by every voice's oscillators. Waveform and antialiasing can be switched
+// from any thread; the other values are plain, so change them on the audio thread
+// (ChordialSynthesiser applies its parameter snapshot there) or before playback.
 template <typename FloatType>
 class ChordialOscillatorMaster
 {
 public:
-    enum class Waveform { /*sine,*/ triangle, saw, square };
+    // wavetable plays the band-limited ChordialWavetable at setWavetablePosition()
+    enum class Waveform { /*sine,*/ triangle, saw, square, wavetable };
 
     void setWaveform(Waveform type)
     {
@@ -35,32 +45,32 @@ public:
 
     void setDetuneAmount(FloatType amount)
     {
-        detuneAmount.store(amount);
+        detuneAmount = amount;
     }
 
     FloatType getDetuneAmount()
     {
-        return detuneAmount.load();
+        return detuneAmount;
     }
     
     void setPanoramicSpread(FloatType amount)
     {
-        panSpreadAmount.store(amount);
+        panSpreadAmount = amount;
     }
 
     FloatType getPanoramicSpread()
     {
-        return panSpreadAmount.load();
+        return panSpreadAmount;
     }
 
     void setFrequencyModulationDepth(FloatType depth)
     {
-        frequencyModulationDepth.store(depth);
+        frequencyModulationDepth = depth;
     }
 
     FloatType getFrequencyModulationDepth()
     {
-        return frequencyModulationDepth.load();
+        return frequencyModulationDepth;
     }
 
     FloatType* getFMInputPtr()
@@ -68,15 +78,30 @@ public:
         return &frequencyModulation;
     }
 
+    // Morphs the wavetable waveform across ChordialWavetable::Shape: 0 sine, 1 triangle,
+    // 2 saw, 3 square, blending the two shapes either side of fractional positions
+    void setWavetablePosition(FloatType position)
+    {
+        wavetablePosition = juce::jlimit(static_cast<FloatType>(0.0), static_cast<FloatType>(ChordialWavetable<FloatType>::numShapes - 1), position);
+    }
+
+    FloatType getWavetablePosition()
+    {
+        return wavetablePosition;
+    }
+
 private:
     friend class ChordialOscillatorVoice<FloatType>;
+    friend class ChordialOscillatorBank<FloatType>;
+    friend class ChordialUnisonOscillator<FloatType>;
     
     std::atomic<Waveform> waveform{ Waveform::triangle };
     std::atomic<bool> antialiased{ true };
-    std::atomic<FloatType> detuneAmount{ static_cast<FloatType>(0.0) };
-    std::atomic<FloatType> panSpreadAmount{ static_cast<FloatType>(0.5) };
+    FloatType detuneAmount{ static_cast<FloatType>(0.0) };
+    FloatType panSpreadAmount{ static_cast<FloatType>(0.5) };
     FloatType frequencyModulation{ static_cast<FloatType>(0.0) };
-    std::atomic<FloatType> frequencyModulationDepth{ static_cast<FloatType>(0.0) };
+    FloatType frequencyModulationDepth{ static_cast<FloatType>(0.0) };
+    FloatType wavetablePosition{ static_cast<FloatType>(0.0) };
 };
 
 
@@ -94,15 +119,44 @@ public:
         masterOscillator = master;
     }
 
+    // Bytes of the block process() renders into before adding to the output, see setScratch()
+    static size_t getScratchSize(const juce::dsp::ProcessSpec& spec) noexcept
+    {
+        ChordialScratchArena::Carver carver;
+        carver.take<FloatType>(spec.maximumBlockSize);
+        return carver.getNumBytesUsed();
+    }
+
+    // Renders into memory of getScratchSize() bytes, aligned as a ChordialScratchArena,
+    // instead of allocating, e.g. one region for all of a voice's oscillators. Not real-time
+    // safe, call before prepare(); nullptr goes back to allocating.
+    void setScratch(char* memory) noexcept { scratch = memory; }
+
     void prepare(const juce::dsp::ProcessSpec& spec)
     {
         this->sampleRate = spec.sampleRate;
+        inverseSampleRate = 1.0 / spec.sampleRate;
         updatePhaseIncrement();
         this->updateDownSampleRate();
 
-        auto maxChannels = juce::jmin<int>((int)spec.numChannels, 2);
-        
-        tempBlock = juce::dsp::AudioBlock<float>(heapBlock, maxChannels, spec.maximumBlockSize);
+        // One channel: process() pans as it adds to the output
+        if (scratch != nullptr)
+        {
+            heapBlock.free();
+            ChordialScratchArena::Carver carver(scratch);
+            scratchChannels[0] = carver.take<FloatType>(spec.maximumBlockSize);
+            tempBlock = juce::dsp::AudioBlock<FloatType>(scratchChannels, 1, spec.maximumBlockSize);
+        }
+        else
+        {
+            tempBlock = juce::dsp::AudioBlock<float>(heapBlock, 1, spec.maximumBlockSize);
+        }
+    }
+
+    // Heap bytes owned, i.e. excluding shared scratch
+    size_t getMemoryUsage() const noexcept
+    {
+        return heapBlock.get() != nullptr ? tempBlock.getNumChannels() * tempBlock.getNumSamples() * sizeof(FloatType) : 0;
     }
 
     template <typename ProcessContext>
@@ -110,36 +164,68 @@ public:
     {
         updateOscillatorFrequency();
         auto& output = context.getOutputBlock();
-        tempBlock.clear();
-        
-        for(int i=0; i<output.getNumSamples(); ++i)
-            tempBlock.setSample(0, i, processSample());
-        
-        for(int i=1; i<tempBlock.getNumChannels(); ++i)
-            tempBlock.getSubsetChannelBlock(i, 1).add(tempBlock.getSubsetChannelBlock(0,1));
-        
-        const auto localPanSpread = masterOscillator->panSpreadAmount.load();
-        const auto localPanMultiplier = panMultiplier.load();
-        const auto panValue = localPanSpread * localPanMultiplier;
-        
-        if (tempBlock.getNumChannels() == 2)
+        const auto numSamples = output.getNumSamples();
+        auto* rendered = tempBlock.getChannelPointer(0);
+
+        processBlock(rendered, numSamples);
+
+        // Pans and adds in one pass per channel. Only the first two channels get the oscillator.
+        const auto panValue = output.getNumChannels() >= 2 ? getPanValue() : static_cast<FloatType>(0.0);
+        const FloatType gains[2] = { panValue > 0 ? static_cast<FloatType>(1.0) - panValue : static_cast<FloatType>(1.0),
+                                     panValue < 0 ? static_cast<FloatType>(1.0) + panValue : static_cast<FloatType>(1.0) };
+
+        for (size_t channel = 0; channel < juce::jmin<size_t>(output.getNumChannels(), 2); ++channel)
         {
-            if (panValue > 0)
-                tempBlock.getSingleChannelBlock(0).multiply(1.0-panValue);
-            else if (panValue < 0)
-                tempBlock.getSingleChannelBlock(1).multiply(1.0+panValue);
+            if (gains[channel] == static_cast<FloatType>(1.0))
+                juce::FloatVectorOperations::add(output.getChannelPointer(channel), rendered, static_cast<int>(numSamples));
+            else
+                juce::FloatVectorOperations::addWithMultiply(output.getChannelPointer(channel), rendered, gains[channel], static_cast<int>(numSamples));
         }
-        
-        output.add(tempBlock);
     }
     
+    // Renders numSamples into output, reading the master state once per block and running
+    // a kernel specialised for the waveform, antialiasing and frequency smoothing state
+    void processBlock(FloatType* output, size_t numSamples)
+    {
+        if (numSamples == 0)
+            return;
+
+        const auto localWaveform = masterOscillator->waveform.load();
+        const auto localAA = masterOscillator->antialiased.load();
+        const auto smoothing = smoothedFrequency.isSmoothing();
+
+        switch (localWaveform)
+        {
+        case Waveform::saw:
+            dispatchBlock<Waveform::saw>(output, numSamples, localAA, smoothing);
+            break;
+        case Waveform::square:
+            dispatchBlock<Waveform::square>(output, numSamples, localAA, smoothing);
+            break;
+        case Waveform::triangle:
+            // Triangle has no antialiased variant
+            dispatchBlock<Waveform::triangle>(output, numSamples, false, smoothing);
+            break;
+        case Waveform::wavetable:
+            // Band-limited already
+            if (smoothing) renderWavetable<true>(output, numSamples);
+            else           renderWavetable<false>(output, numSamples);
+            break;
+        default:
+            std::fill(output, output + numSamples, static_cast<FloatType>(0.0));
+            break;
+        }
+
+        lastOutput = output[numSamples - 1];
+    }
+
     FloatType processSample()
     {
         updatePhaseIncrement();
         const auto localWaveform = masterOscillator->waveform.load();
         const auto localAA = masterOscillator->antialiased.load();
         //const auto pi = juce::MathConstants<FloatType>::pi;
-        FloatType t = phase / juce::MathConstants<FloatType>::twoPi;
+        const auto t = phase.template getNormalisedPhase<FloatType>();
         //FloatType x = 0.0;
         
         switch (localWaveform)
@@ -152,13 +238,13 @@ public:
             break;*/
                 
         case ChordialOscillatorMaster<FloatType>::Waveform::saw:
-            lastOutput = 2.0 * (phase / juce::MathConstants<FloatType>::twoPi) - 1.0;
+            lastOutput = 2.0 * t - 1.0;
             if(localAA)
                 lastOutput -= blep(t);
             break;
                 
         case ChordialOscillatorMaster<FloatType>::Waveform::square:
-            if(phase < juce::MathConstants<FloatType>::pi)
+            if(t < 0.5)
                 lastOutput = 1.0;
             else
                 lastOutput = -1.0;
@@ -166,25 +252,29 @@ public:
             if(localAA)
             {
                 lastOutput += blep(t);
-                lastOutput -= blep(std::fmod(t + 0.5, 1.0));
+                lastOutput -= blep(PhaseAccumulator::template toNormalised<FloatType>(phase.phase + PhaseAccumulator::half));
             }
             break;
 
         case ChordialOscillatorMaster<FloatType>::Waveform::triangle:
-            lastOutput = 2.0 * std::abs(2.0 * (phase / juce::MathConstants<FloatType>::twoPi) - 1.0) - 1.0;
+            lastOutput = 2.0 * std::abs(2.0 * t - 1.0) - 1.0;
+            break;
+
+        case ChordialOscillatorMaster<FloatType>::Waveform::wavetable:
+            lastOutput = wavetableSample(getWavetableMorph(*masterOscillator));
             break;
                 
         default:
             lastOutput = 0.0;
         }
         
-        updatePhase();
+        phase.advance();
         return lastOutput;
     }
 
     void reset()
     {
-        phase = 0.0;
+        phase.reset();
     }
 
     void setBaseFrequency(FloatType frequencyInHz)
@@ -195,22 +285,22 @@ public:
 
 	void setBaseFrequencyWithoutUpdating(FloatType frequencyInHz)
 	{
-		baseFrequency.store(frequencyInHz);
+		baseFrequency = frequencyInHz;
 	}
 
     FloatType getBaseFrequency()
     {
-        return baseFrequency.load();
+        return baseFrequency;
     }
     
     void setDetuneMultiplier(FloatType multiplier)
     {
-        detuneMultiplier.store(multiplier);
+        detuneMultiplier = multiplier;
     }
     
     void setPanoramicSpreadMultiplier(FloatType multiplier)
     {
-        panMultiplier.store(multiplier);
+        panMultiplier = multiplier;
     }
 
     FloatType* getOutputPtr()
@@ -220,38 +310,193 @@ public:
 
 
 
+    FloatType getPanValue()
+    {
+        return masterOscillator->panSpreadAmount * panMultiplier;
+    }
+
+    // Base frequency with detune and frequency modulation applied
+    FloatType getTargetFrequency()
+    {
+        const auto localDetune = masterOscillator->detuneAmount;
+        const auto localDetuneMultiplier = detuneMultiplier;
+        const auto localFMDepth = masterOscillator->frequencyModulationDepth;
+
+        auto detunedFrequency = baseFrequency * fastmath::octavesToRatio(localDetune* localDetuneMultiplier);
+
+        detunedFrequency *= fastmath::octavesToRatio(localFMDepth * masterOscillator->frequencyModulation);
+
+        return static_cast<FloatType>(detunedFrequency);
+    }
+
     // call this every control processing block
     void updateOscillatorFrequency(bool force = false)
     {
-        const auto localDetune = masterOscillator->detuneAmount.load();
-        const auto localDetuneMultiplier = detuneMultiplier.load();
-        const auto localFMDepth = masterOscillator->frequencyModulationDepth.load();
+        smoothedFrequency.setValue(getTargetFrequency(), force);
+    }
+private:
+    // Shares waveformSample()
+    friend class ChordialUnisonOscillator<FloatType>;
 
-        auto detunedFrequency = baseFrequency.load() * std::pow(2.0, localDetune* localDetuneMultiplier);
+    using Waveform = typename ChordialOscillatorMaster<FloatType>::Waveform;
+    using PhaseAccumulator = ChordialPhaseAccumulator<>;
+    using Wavetable = ChordialWavetable<FloatType>;
 
-        detunedFrequency *= std::pow(2.0, localFMDepth * masterOscillator->frequencyModulation);
+    // The shape below the master's wavetable position and the blend towards the next
+    static std::pair<int, FloatType> getWavetableMorph(const ChordialOscillatorMaster<FloatType>& master) noexcept
+    {
+        const auto position = master.wavetablePosition;
+        const auto shape = juce::jmin(static_cast<int>(position), Wavetable::numShapes - 2);
+        return { shape, position - static_cast<FloatType>(shape) };
+    }
+
+    // At the current phase, from the mip level for the current increment
+    FloatType wavetableSample(std::pair<int, FloatType> morph) const noexcept
+    {
+        const auto level = Wavetable::getLevel(phase.increment);
+        const auto from = Wavetable::lookup(wavetable->getTable(morph.first, level), phase.phase);
+        if (morph.second <= 0)
+            return from;
 
-        smoothedFrequency.setValue(detunedFrequency, force);
+        const auto to = Wavetable::lookup(wavetable->getTable(morph.first + 1, level), phase.phase);
+        return from + morph.second * (to - from);
     }
-private:
-    // Every sample
-    void updatePhaseIncrement()
+
+    // One interpolated table read per sample, two while morphing between shapes
+    template <bool smoothing>
+    void renderWavetable(FloatType* output, size_t numSamples)
     {
-        const auto nextFrequencyValue = smoothedFrequency.getNextValue();
-        phaseIncrement = nextFrequencyValue * 2 * juce::MathConstants<FloatType>::pi / this->sampleRate;
+        const auto morph = getWavetableMorph(*masterOscillator);
+
+        if (smoothing)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                updatePhaseIncrement();
+                output[i] = wavetableSample(morph);
+                phase.advance();
+            }
+            return;
+        }
+
+        phase.setCyclesPerSample(smoothedFrequency.getTargetValue() * inverseSampleRate);
+        const auto level = Wavetable::getLevel(phase.increment);
+        const auto* from = wavetable->getTable(morph.first, level);
+
+        if (morph.second <= 0)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+                output[i] = Wavetable::lookup(from, phase.getPhaseAt(i));
+        }
+        else
+        {
+            const auto* to = wavetable->getTable(morph.first + 1, level);
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                const auto p = phase.getPhaseAt(i);
+                const auto a = Wavetable::lookup(from, p);
+                output[i] = a + morph.second * (Wavetable::lookup(to, p) - a);
+            }
+        }
+
+        phase.advance(numSamples);
     }
 
-    void updatePhase()
+    template <Waveform waveform>
+    void dispatchBlock(FloatType* output, size_t numSamples, bool antialiased, bool smoothing)
     {
-        phase += phaseIncrement;
-        while (phase >= juce::MathConstants<FloatType>::twoPi) {
-            phase -= juce::MathConstants<FloatType>::twoPi;
+        if (antialiased)
+        {
+            if (smoothing) renderBlock<waveform, true, true>(output, numSamples);
+            else           renderBlock<waveform, true, false>(output, numSamples);
+        }
+        else
+        {
+            if (smoothing) renderBlock<waveform, false, true>(output, numSamples);
+            else           renderBlock<waveform, false, false>(output, numSamples);
         }
     }
-    
+
+    template <Waveform waveform, bool antialiased, bool smoothing>
+    void renderBlock(FloatType* output, size_t numSamples)
+    {
+        if (smoothing)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                updatePhaseIncrement();
+                const auto dt = phase.template getNormalisedIncrement<FloatType>();
+                const auto inverseDt = dt > 0 ? static_cast<FloatType>(1.0) / dt : static_cast<FloatType>(0.0);
+                output[i] = waveformSample<waveform, antialiased>(phase.template getNormalisedPhase<FloatType>(), dt, inverseDt);
+                phase.advance();
+            }
+        }
+        else
+        {
+            // Constant increment: each sample's phase is independent, so the loop vectorises
+            phase.setCyclesPerSample(smoothedFrequency.getTargetValue() * inverseSampleRate);
+            const auto dt = phase.template getNormalisedIncrement<FloatType>();
+            const auto inverseDt = dt > 0 ? static_cast<FloatType>(1.0) / dt : static_cast<FloatType>(0.0);
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                const auto t = PhaseAccumulator::template toNormalised<FloatType>(phase.getPhaseAt(i));
+                output[i] = waveformSample<waveform, antialiased>(t, dt, inverseDt);
+            }
+
+            phase.advance(numSamples);
+        }
+    }
+
+    template <Waveform waveform, bool antialiased>
+    static FloatType waveformSample(FloatType t, FloatType dt, FloatType inverseDt) noexcept
+    {
+        const auto one = static_cast<FloatType>(1.0);
+
+        if (waveform == Waveform::saw)
+        {
+            auto value = static_cast<FloatType>(2.0) * t - one;
+            if (antialiased)
+                value -= polyBlep(t, dt, inverseDt);
+            return value;
+        }
+
+        if (waveform == Waveform::square)
+        {
+            auto value = t < static_cast<FloatType>(0.5) ? one : -one;
+            if (antialiased)
+            {
+                auto shifted = t + static_cast<FloatType>(0.5);
+                shifted -= shifted >= one ? one : static_cast<FloatType>(0.0);
+                value += polyBlep(t, dt, inverseDt);
+                value -= polyBlep(shifted, dt, inverseDt);
+            }
+            return value;
+        }
+
+        return static_cast<FloatType>(2.0) * std::abs(static_cast<FloatType>(2.0) * t - one) - one;
+    }
+
+    // Branch-free blep(), t and dt normalised to one cycle
+    static FloatType polyBlep(FloatType t, FloatType dt, FloatType inverseDt) noexcept
+    {
+        const auto one = static_cast<FloatType>(1.0);
+        const auto rising = t * inverseDt;
+        const auto falling = (t - one) * inverseDt;
+        const auto start = t < dt ? rising + rising - rising * rising - one : static_cast<FloatType>(0.0);
+        const auto end = t > one - dt ? falling * falling + falling + falling + one : static_cast<FloatType>(0.0);
+        return start + end;
+    }
+
+    // Every sample
+    void updatePhaseIncrement()
+    {
+        phase.setCyclesPerSample(smoothedFrequency.getNextValue() * inverseSampleRate);
+    }
+
     FloatType blep(FloatType t)
     {
-        FloatType dt = phaseIncrement / juce::MathConstants<FloatType>::twoPi;
+        const auto dt = phase.template getNormalisedIncrement<FloatType>();
         if (t < dt) {
             t /= dt;
             return t + t - t*t - 1.0;
@@ -274,14 +519,17 @@ private:
 
     juce::LinearSmoothedValue<FloatType> smoothedFrequency{ static_cast<FloatType>(440.0) };
     
-    std::atomic<FloatType> detuneMultiplier{ static_cast<FloatType>(1.0) };
-    std::atomic<FloatType> panMultiplier{ static_cast<FloatType>(1.0) };
+    FloatType detuneMultiplier{ static_cast<FloatType>(1.0) };
+    FloatType panMultiplier{ static_cast<FloatType>(1.0) };
 
     // For oscillator implementation
-    std::atomic<FloatType> baseFrequency{ static_cast<FloatType>(440.0) };
-    FloatType phase{ static_cast<FloatType>(0.0) };
-    FloatType phaseIncrement;
+    FloatType baseFrequency{ static_cast<FloatType>(440.0) };
+    PhaseAccumulator phase;
+    const Wavetable* wavetable{ &Wavetable::getShared() };
+    double inverseSampleRate{ 1.0 / 44100.0 };
     juce::HeapBlock<char> heapBlock;
+    char* scratch{ nullptr };
+    FloatType* scratchChannels[1] = {};
     juce::dsp::AudioBlock<FloatType> tempBlock;
 };
 
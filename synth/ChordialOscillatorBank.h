@@ -0,0 +1,301 @@
+/*
+  ==============================================================================
+
+    ChordialOscillatorBank.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Renders the oscillators of every voice together. Phase, increment and frequency
+    smoothing live in structure-of-arrays form, one slot per oscillator, and slots are
+    processed ChordialSIMDRegister::SIMDNumElements at a time (4 lanes for SSE/NEON,
+    8 for AVX).
+
+    Tolerance against ChordialOscillatorVoice::processSample(): triangle within 1e-3 and
+    antialiased saw/square within 0.01 over one second of a 1.2 kHz tone. The scalar path's
+    ChordialPhaseAccumulator doesn't drift, so the residual is the float phase accumulated
+    here, which PolyBLEP scales by 1/dt around each edge. Without antialiasing an edge can
+    land one sample apart.
+*/
+template <typename FloatType>
+class ChordialOscillatorBank : public ChordialModuleVoice<FloatType>
+{
+public:
+    using Register = ChordialSIMDRegister<FloatType>;
+    using Waveform = typename ChordialOscillatorMaster<FloatType>::Waveform;
+
+    static constexpr size_t lanes = Register::SIMDNumElements;
+    static constexpr int oscillatorsPerVoice = 3;
+
+    void setMasterOscillator(std::shared_ptr<ChordialOscillatorMaster<FloatType>> master)
+    {
+        masterOscillator = master;
+    }
+
+    // Not real-time safe, call from the message thread before prepare()
+    void setNumVoices(int numVoices)
+    {
+        numSlots = static_cast<size_t>(numVoices * oscillatorsPerVoice);
+        numGroups = (numSlots + lanes - 1) / lanes;
+
+        const auto paddedSlots = numGroups * lanes;
+        phase.allocate(paddedSlots);
+        currentFrequency.allocate(paddedSlots);
+        targetFrequency.allocate(paddedSlots);
+        frequencyStep.allocate(paddedSlots);
+        countdown.allocate(paddedSlots);
+        groupActive.assign(numGroups, false);
+
+        allocateOutput();
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        this->sampleRate = spec.sampleRate;
+        maximumBlockSize = spec.maximumBlockSize;
+        this->updateDownSampleRate();
+        allocateOutput();
+        reset();
+    }
+
+    void reset()
+    {
+        phase.clear();
+        frequencyStep.clear();
+        countdown.clear();
+    }
+
+    // Audio thread. Marks the slot's group for rendering in the next process() call.
+    void setFrequency(int slot, FloatType frequencyInHz, bool force = false)
+    {
+        jassert(juce::isPositiveAndBelow(static_cast<size_t>(slot), numSlots));
+
+        auto& target = targetFrequency.get()[slot];
+        auto& current = currentFrequency.get()[slot];
+        auto& remaining = countdown.get()[slot];
+
+        groupActive[static_cast<size_t>(slot) / lanes] = true;
+
+        if (force)
+        {
+            target = current = frequencyInHz;
+            remaining = static_cast<FloatType>(0.0);
+            return;
+        }
+
+        if (target != frequencyInHz)
+        {
+            target = frequencyInHz;
+            remaining = static_cast<FloatType>(stepsToTarget);
+
+            if (stepsToTarget <= 0)
+                current = target;
+            else
+                frequencyStep.get()[slot] = (target - current) / static_cast<FloatType>(stepsToTarget);
+        }
+    }
+
+    // Renders numSamples for every group touched by setFrequency() since the last call
+    void process(size_t numSamples)
+    {
+        jassert(numSamples <= maximumBlockSize);
+        jassert(masterOscillator != nullptr);
+
+        const auto localWaveform = masterOscillator->waveform.load();
+        const auto localAA = masterOscillator->antialiased.load();
+
+        for (size_t group = 0; group < numGroups; ++group)
+        {
+            if (!groupActive[group])
+                continue;
+
+            groupActive[group] = false;
+
+            switch (localWaveform)
+            {
+            case Waveform::saw:
+                if (localAA) processGroup<Waveform::saw, true>(group, numSamples);
+                else         processGroup<Waveform::saw, false>(group, numSamples);
+                break;
+            case Waveform::square:
+                if (localAA) processGroup<Waveform::square, true>(group, numSamples);
+                else         processGroup<Waveform::square, false>(group, numSamples);
+                break;
+            case Waveform::wavetable:
+                processGroup<Waveform::wavetable, false>(group, numSamples);
+                break;
+            case Waveform::triangle:
+            default:
+                processGroup<Waveform::triangle, false>(group, numSamples);
+                break;
+            }
+        }
+    }
+
+    // Adds a slot's last rendered output into a voice block, applying the same pan law as
+    // ChordialOscillatorVoice::process
+    void addSlotToBlock(int slot, size_t startSample, const juce::dsp::AudioBlock<FloatType>& block, FloatType panValue) const
+    {
+        const auto group = static_cast<size_t>(slot) / lanes;
+        const auto lane = static_cast<size_t>(slot) % lanes;
+        const auto* source = output.get() + (group * maximumBlockSize + startSample) * lanes + lane;
+
+        const auto numSamples = block.getNumSamples();
+        auto* left = block.getChannelPointer(0);
+
+        if (block.getNumChannels() < 2)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+                left[i] += source[i * lanes];
+            return;
+        }
+
+        auto* right = block.getChannelPointer(1);
+        const auto leftGain = panValue > 0 ? static_cast<FloatType>(1.0) - panValue : static_cast<FloatType>(1.0);
+        const auto rightGain = panValue < 0 ? static_cast<FloatType>(1.0) + panValue : static_cast<FloatType>(1.0);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto sample = source[i * lanes];
+            left[i] += sample * leftGain;
+            right[i] += sample * rightGain;
+        }
+    }
+
+private:
+    template <Waveform waveform, bool antialiased>
+    void processGroup(size_t group, size_t numSamples)
+    {
+        const auto offset = group * lanes;
+        const auto zero = Register::expand(static_cast<FloatType>(0.0));
+        const auto one = Register::expand(static_cast<FloatType>(1.0));
+        const auto half = Register::expand(static_cast<FloatType>(0.5));
+        const auto two = Register::expand(static_cast<FloatType>(2.0));
+        const auto inverseSampleRate = static_cast<FloatType>(1.0 / this->sampleRate);
+
+        auto p = Register::fromRawArray(phase.get() + offset);
+        auto current = Register::fromRawArray(currentFrequency.get() + offset);
+        const auto target = Register::fromRawArray(targetFrequency.get() + offset);
+        const auto step = Register::fromRawArray(frequencyStep.get() + offset);
+        auto remaining = Register::fromRawArray(countdown.get() + offset);
+
+        // Exact reciprocal of the increment at the block start, then Newton-refined per sample
+        auto inverseIncrement = zero;
+        if (antialiased)
+        {
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                const auto increment = current.get(lane) * inverseSampleRate;
+                inverseIncrement.set(lane, increment > 0 ? static_cast<FloatType>(1.0) / increment : static_cast<FloatType>(0.0));
+            }
+        }
+
+        auto* out = output.get() + group * maximumBlockSize * lanes;
+
+        // The wavetable's morph, see ChordialOscillatorVoice
+        using Wavetable = ChordialWavetable<FloatType>;
+        const auto position = masterOscillator->wavetablePosition;
+        const auto shape = juce::jmin(static_cast<int>(position), Wavetable::numShapes - 2);
+        const auto blend = position - static_cast<FloatType>(shape);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            // LinearSmoothedValue::getNextValue() for every lane
+            const auto smoothing = Register::greaterThan(remaining, zero);
+            remaining -= one & smoothing;
+            current += step & smoothing;
+            current = simd::select(Register::lessThanOrEqual(remaining, zero), target, current);
+
+            const auto increment = current * inverseSampleRate;
+            Register value;
+
+            if (waveform == Waveform::saw)
+            {
+                value = p * two - one;
+            }
+            else if (waveform == Waveform::square)
+            {
+                value = simd::select(Register::lessThan(p, half), one, zero - one);
+            }
+            else if (waveform == Waveform::triangle)
+            {
+                value = simd::abs(p * two - one) * two - one;
+            }
+            else
+            {
+                // Registers have no gather, so the table reads go lane by lane
+                for (size_t lane = 0; lane < lanes; ++lane)
+                {
+                    const auto laneIncrement = ChordialPhaseAccumulator<>::toIncrement(increment.get(lane));
+                    const auto lanePhase = ChordialPhaseAccumulator<>::toIncrement(p.get(lane));
+                    const auto level = Wavetable::getLevel(laneIncrement);
+                    auto sample = Wavetable::lookup(wavetable->getTable(shape, level), lanePhase);
+                    if (blend > 0)
+                        sample += blend * (Wavetable::lookup(wavetable->getTable(shape + 1, level), lanePhase) - sample);
+                    value.set(lane, sample);
+                }
+            }
+
+            if (antialiased)
+            {
+                inverseIncrement = simd::refineReciprocal(increment, inverseIncrement);
+
+                if (waveform == Waveform::saw)
+                {
+                    value -= simd::polyBlep(p, increment, inverseIncrement);
+                }
+                else if (waveform == Waveform::square)
+                {
+                    auto shifted = p + half;
+                    shifted -= one & Register::greaterThanOrEqual(shifted, one);
+                    value += simd::polyBlep(p, increment, inverseIncrement);
+                    value -= simd::polyBlep(shifted, increment, inverseIncrement);
+                }
+            }
+
+            value.copyToRawArray(out + i * lanes);
+
+            p += increment;
+            p -= one & Register::greaterThanOrEqual(p, one);
+        }
+
+        p.copyToRawArray(phase.get() + offset);
+        current.copyToRawArray(currentFrequency.get() + offset);
+        remaining.copyToRawArray(countdown.get() + offset);
+    }
+
+    void updateSmoothing(FloatType time) override
+    {
+        stepsToTarget = static_cast<int>(std::floor(time * this->sampleRate));
+    }
+
+    void allocateOutput()
+    {
+        output.allocate(numGroups * lanes * maximumBlockSize);
+    }
+
+    std::shared_ptr<ChordialOscillatorMaster<FloatType>> masterOscillator;
+    const ChordialWavetable<FloatType>* wavetable{ &ChordialWavetable<FloatType>::getShared() };
+
+    size_t numSlots{ 0 };
+    size_t numGroups{ 0 };
+    size_t maximumBlockSize{ 0 };
+    int stepsToTarget{ 0 };
+
+    ChordialAlignedBuffer<FloatType> phase;
+    ChordialAlignedBuffer<FloatType> currentFrequency;
+    ChordialAlignedBuffer<FloatType> targetFrequency;
+    ChordialAlignedBuffer<FloatType> frequencyStep;
+    ChordialAlignedBuffer<FloatType> countdown;
+    ChordialAlignedBuffer<FloatType> output;
+    std::vector<bool> groupActive;
+};
+
+}
+}
@@ -0,0 +1,342 @@
+/*
+  ==============================================================================
+
+    ChordialOversampling.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  2x, 4x or 8x oversampling with cascaded polyphase IIR half-band stages, one
+    independent stream per lane, processed ChordialSIMDRegister::SIMDNumElements lanes
+    at a time on data laid out [sample][lane].
+
+    Each stage is the two-path allpass half-band of de Soras' HIIR (elliptic design):
+    the stage next to the base rate uses 6 coefficients for a 0.1 transition band, the
+    outer stages 4 coefficients for 0.2, all above 100 dB stopband rejection.
+
+    The factor can change from block to block without allocating. Stages that come back
+    into use start from the steady state for the group's last input and output samples,
+    which the allpasses pass unchanged at DC, rather than from silence, so moving up does
+    not click. The two working buffers only hold
+    data from a processUp() to its processDown(), so they can live in shared scratch.
+    copyLane() moves a lane's stream between oversamplers, so lanes of many can be
+    gathered into one group (see ChordialFilterBank).
+*/
+template <typename SampleType>
+class ChordialOversampler
+{
+public:
+    using Register = ChordialSIMDRegister<SampleType>;
+
+    static constexpr size_t lanes = Register::SIMDNumElements;
+    static constexpr int maxFactorLog2 = 3;
+
+    // Bytes of working buffers for blocks of up to maximumBlockSize samples
+    static size_t getScratchSize(size_t maximumBlockSize) noexcept
+    {
+        ChordialScratchArena::Carver carver;
+        for (int i = 0; i < 2; ++i)
+            carver.take<SampleType>(lanes * (maximumBlockSize << maxFactorLog2));
+        return carver.getNumBytesUsed();
+    }
+
+    // Puts the working buffers in memory of getScratchSize() bytes, aligned as a
+    // ChordialScratchArena, instead of allocating them. Not real-time safe, call before
+    // prepare(); nullptr goes back to allocating.
+    void setScratch(char* memory) noexcept { scratch = memory; }
+
+    // Not real-time safe
+    void prepare(size_t newNumLanes, size_t newMaximumBlockSize)
+    {
+        numGroups = (newNumLanes + lanes - 1) / lanes;
+        maximumBlockSize = newMaximumBlockSize;
+
+        for (int stage = 0; stage < maxFactorLog2; ++stage)
+        {
+            upState[stage].allocate(numGroups * stateSize(stage));
+            downState[stage].allocate(numGroups * stateSize(stage));
+        }
+
+        ChordialScratchArena::Carver carver(scratch);
+        for (int i = 0; i < 2; ++i)
+        {
+            ownedBuffers[i] = {};
+            if (scratch != nullptr)
+            {
+                buffers[i] = carver.take<SampleType>(lanes * (maximumBlockSize << maxFactorLog2));
+            }
+            else
+            {
+                ownedBuffers[i].allocate(lanes * (maximumBlockSize << maxFactorLog2));
+                buffers[i] = ownedBuffers[i].get();
+            }
+        }
+
+        edges.allocate(numGroups * 2 * lanes);
+        groupFactor.assign(numGroups, 0);
+        reset();
+    }
+
+    // Heap bytes owned, i.e. excluding shared scratch
+    size_t getMemoryUsage() const noexcept
+    {
+        size_t bytes = groupFactor.capacity() * sizeof(int) + edges.getMemoryUsage();
+        for (int stage = 0; stage < maxFactorLog2; ++stage)
+            bytes += upState[stage].getMemoryUsage() + downState[stage].getMemoryUsage();
+        for (auto& buffer : ownedBuffers)
+            bytes += buffer.getMemoryUsage();
+        return bytes;
+    }
+
+    void reset()
+    {
+        for (int stage = 0; stage < maxFactorLog2; ++stage)
+        {
+            upState[stage].clear();
+            downState[stage].clear();
+        }
+        edges.clear();
+    }
+
+    // Moves a lane group to factorLog2, settling the stages that come back into use on its
+    // last samples. processUp() does this itself; call it for a group whose audio is
+    // oversampled elsewhere.
+    void useFactor(size_t group, int factorLog2) noexcept
+    {
+        jassert(group < numGroups);
+        jassert(juce::isPositiveAndNotGreaterThan(factorLog2, maxFactorLog2));
+
+        for (auto stage = groupFactor[group]; stage < factorLog2; ++stage)
+        {
+            settleGroup(upState[stage], stage, group, getEdge(group, 0));
+            settleGroup(downState[stage], stage, group, getEdge(group, 1));
+        }
+        groupFactor[group] = factorLog2;
+    }
+
+    // Copies the state of lane fromLane of from to lane toLane of to, for the stages used at
+    // factorLog2 and its last samples, and moves toLane's group to that factor. from's group must already be
+    // there, see useFactor().
+    static void copyLane(const ChordialOversampler& from, size_t fromLane, ChordialOversampler& to, size_t toLane, int factorLog2) noexcept
+    {
+        const auto fromGroup = fromLane / lanes;
+        const auto toGroup = toLane / lanes;
+
+        jassert(fromGroup < from.numGroups && toGroup < to.numGroups);
+        jassert(from.groupFactor[fromGroup] == factorLog2);
+
+        for (int stage = 0; stage < factorLog2; ++stage)
+        {
+            const auto* fromUp = from.upState[stage].get() + fromGroup * stateSize(stage) + fromLane % lanes;
+            const auto* fromDown = from.downState[stage].get() + fromGroup * stateSize(stage) + fromLane % lanes;
+            auto* toUp = to.upState[stage].get() + toGroup * stateSize(stage) + toLane % lanes;
+            auto* toDown = to.downState[stage].get() + toGroup * stateSize(stage) + toLane % lanes;
+
+            for (size_t i = 0; i < stateSize(stage); i += lanes)
+            {
+                toUp[i] = fromUp[i];
+                toDown[i] = fromDown[i];
+            }
+        }
+
+        for (size_t edge = 0; edge < 2; ++edge)
+            to.getEdge(toGroup, edge)[toLane % lanes] = from.getEdge(fromGroup, edge)[fromLane % lanes];
+
+        to.groupFactor[toGroup] = factorLog2;
+    }
+
+    // Upsamples numSamples of one lane group by 2^factorLog2. The result stays valid until
+    // the next processUp() call and can be processed in place before processDown().
+    SampleType* processUp(size_t group, const SampleType* input, size_t numSamples, int factorLog2) noexcept
+    {
+        jassert(numSamples <= maximumBlockSize);
+        useFactor(group, factorLog2);
+
+        auto* data = buffers[0];
+        std::copy(input, input + numSamples * lanes, data);
+        if (numSamples > 0)
+            std::copy(input + (numSamples - 1) * lanes, input + numSamples * lanes, getEdge(group, 0));
+
+        for (int stage = 0; stage < factorLog2; ++stage)
+        {
+            auto* upsampled = buffers[(stage + 1) % 2];
+            processStageUp(stage, group, data, upsampled, numSamples << stage);
+            data = upsampled;
+        }
+
+        oversampled = data;
+        return data;
+    }
+
+    // Downsamples the group's last processUp() result back to numSamples into output
+    void processDown(size_t group, SampleType* output, size_t numSamples, int factorLog2) noexcept
+    {
+        jassert(group < numGroups);
+        jassert(groupFactor[group] == factorLog2);
+
+        if (factorLog2 == 0)
+        {
+            std::copy(oversampled, oversampled + numSamples * lanes, output);
+        }
+        else
+        {
+            auto* data = oversampled;
+
+            for (int stage = factorLog2 - 1; stage >= 0; --stage)
+            {
+                auto* downsampled = stage == 0 ? output : (data == buffers[0] ? buffers[1] : buffers[0]);
+                processStageDown(stage, group, data, downsampled, numSamples << stage);
+                data = downsampled;
+            }
+        }
+
+        if (numSamples > 0)
+            std::copy(output + (numSamples - 1) * lanes, output + numSamples * lanes, getEdge(group, 1));
+    }
+
+private:
+    static constexpr int maxCoefficients = 6;
+
+    static int getNumCoefficients(int stage) noexcept { return stage == 0 ? 6 : 4; }
+
+    static const SampleType* getCoefficients(int stage) noexcept
+    {
+        static const SampleType inner[] = {
+            static_cast<SampleType>(0.039151597734460045), static_cast<SampleType>(0.1473771136010466),
+            static_cast<SampleType>(0.3026468483284934), static_cast<SampleType>(0.48246854276970014),
+            static_cast<SampleType>(0.6746159185469639), static_cast<SampleType>(0.8830050257693731)
+        };
+        static const SampleType outer[] = {
+            static_cast<SampleType>(0.04955103531301993), static_cast<SampleType>(0.193570326347404),
+            static_cast<SampleType>(0.42673668875647364), static_cast<SampleType>(0.7670700728130814)
+        };
+
+        return stage == 0 ? inner : outer;
+    }
+
+    // Input and output memory of every allpass, for one lane group
+    static size_t stateSize(int stage) noexcept
+    {
+        return static_cast<size_t>(getNumCoefficients(stage)) * 2 * lanes;
+    }
+
+    // The group's last input (edge 0) or output (edge 1) sample, one per lane
+    SampleType* getEdge(size_t group, size_t edge) const noexcept
+    {
+        return edges.get() + (group * 2 + edge) * lanes;
+    }
+
+    // Sets every allpass memory of a stage to the lanes' values, where a constant input
+    // at them leaves it
+    void settleGroup(ChordialAlignedBuffer<SampleType>& buffer, int stage, size_t group, const SampleType* values) noexcept
+    {
+        auto* state = buffer.get() + group * stateSize(stage);
+        for (size_t i = 0; i < stateSize(stage); i += lanes)
+            std::copy(values, values + lanes, state + i);
+    }
+
+    // One first order allpass in z^-2, run at the lower of the stage's two rates
+    static Register allpass(Register x, Register& inputMemory, Register& outputMemory, SampleType coefficient) noexcept
+    {
+        const auto y = (x - outputMemory) * coefficient + inputMemory;
+        inputMemory = x;
+        outputMemory = y;
+        return y;
+    }
+
+    // numSamples inputs to 2 * numSamples outputs: even coefficients on the first output
+    // of each pair, odd coefficients on the second
+    void processStageUp(int stage, size_t group, const SampleType* input, SampleType* output, size_t numSamples) noexcept
+    {
+        const auto numCoefficients = getNumCoefficients(stage);
+        const auto* coefficients = getCoefficients(stage);
+        auto* state = upState[stage].get() + group * stateSize(stage);
+
+        Register inputMemory[maxCoefficients], outputMemory[maxCoefficients];
+        for (int c = 0; c < numCoefficients; ++c)
+        {
+            inputMemory[c] = Register::fromRawArray(state + (2 * c) * lanes);
+            outputMemory[c] = Register::fromRawArray(state + (2 * c + 1) * lanes);
+        }
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto x = Register::fromRawArray(input + i * lanes);
+            auto even = x;
+            auto odd = x;
+
+            for (int c = 0; c < numCoefficients; c += 2)
+            {
+                even = allpass(even, inputMemory[c], outputMemory[c], coefficients[c]);
+                odd = allpass(odd, inputMemory[c + 1], outputMemory[c + 1], coefficients[c + 1]);
+            }
+
+            even.copyToRawArray(output + (2 * i) * lanes);
+            odd.copyToRawArray(output + (2 * i + 1) * lanes);
+        }
+
+        for (int c = 0; c < numCoefficients; ++c)
+        {
+            inputMemory[c].copyToRawArray(state + (2 * c) * lanes);
+            outputMemory[c].copyToRawArray(state + (2 * c + 1) * lanes);
+        }
+    }
+
+    // 2 * numSamples inputs to numSamples outputs
+    void processStageDown(int stage, size_t group, const SampleType* input, SampleType* output, size_t numSamples) noexcept
+    {
+        const auto numCoefficients = getNumCoefficients(stage);
+        const auto* coefficients = getCoefficients(stage);
+        auto* state = downState[stage].get() + group * stateSize(stage);
+
+        Register inputMemory[maxCoefficients], outputMemory[maxCoefficients];
+        for (int c = 0; c < numCoefficients; ++c)
+        {
+            inputMemory[c] = Register::fromRawArray(state + (2 * c) * lanes);
+            outputMemory[c] = Register::fromRawArray(state + (2 * c + 1) * lanes);
+        }
+
+        const auto half = static_cast<SampleType>(0.5);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto even = Register::fromRawArray(input + (2 * i + 1) * lanes);
+            auto odd = Register::fromRawArray(input + (2 * i) * lanes);
+
+            for (int c = 0; c < numCoefficients; c += 2)
+            {
+                even = allpass(even, inputMemory[c], outputMemory[c], coefficients[c]);
+                odd = allpass(odd, inputMemory[c + 1], outputMemory[c + 1], coefficients[c + 1]);
+            }
+
+            ((even + odd) * half).copyToRawArray(output + i * lanes);
+        }
+
+        for (int c = 0; c < numCoefficients; ++c)
+        {
+            inputMemory[c].copyToRawArray(state + (2 * c) * lanes);
+            outputMemory[c].copyToRawArray(state + (2 * c + 1) * lanes);
+        }
+    }
+
+    size_t numGroups{ 0 };
+    size_t maximumBlockSize{ 0 };
+
+    ChordialAlignedBuffer<SampleType> upState[maxFactorLog2];
+    ChordialAlignedBuffer<SampleType> downState[maxFactorLog2];
+    ChordialAlignedBuffer<SampleType> edges;
+    ChordialAlignedBuffer<SampleType> ownedBuffers[2];
+    SampleType* buffers[2] = {};
+    char* scratch{ nullptr };
+    SampleType* oversampled{ nullptr };
+    std::vector<int> groupFactor;
+};
+
+}
+}
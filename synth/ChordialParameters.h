@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    ChordialParameters.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+// Plain copy of every registered parameter, owned by the audio thread
+struct alignas(64) ChordialParameterSnapshot
+{
+    static constexpr int maxParameters = 32;
+
+    float values[maxParameters] = {};
+    juce::uint32 version{ 0 };
+
+    float operator[](int index) const noexcept { return values[index]; }
+};
+
+/*  Index-based parameter store between the message thread and the audio thread.
+
+    Parameters are registered once and addressed by the index add() returns. set()
+    writes the new value into the unpublished half of a double buffer and publishes it;
+    acquire() copies the published half into the audio thread's snapshot, once per block
+    and only when something changed. Each half carries a sequence count, so in the rare
+    case of two publishes landing during one copy the reader simply copies again.
+*/
+class ChordialParameterRegistry
+{
+public:
+    static constexpr int maxParameters = ChordialParameterSnapshot::maxParameters;
+
+    // Not real-time safe, call before playback. Returns the parameter's index.
+    int add(const juce::String& parameterID, float defaultValue)
+    {
+        jassert(numParameters < maxParameters);
+        jassert(indexOf(parameterID) < 0);
+
+        ids.add(parameterID);
+        const auto index = numParameters++;
+        set(index, defaultValue);
+        return index;
+    }
+
+    int indexOf(const juce::String& parameterID) const
+    {
+        return ids.indexOf(parameterID);
+    }
+
+    const juce::String& getParameterID(int index) const { return ids.getReference(index); }
+    int getNumParameters() const noexcept { return numParameters; }
+
+    // Any thread but the audio thread
+    void set(int index, float value)
+    {
+        jassert(juce::isPositiveAndBelow(index, numParameters));
+
+        const juce::SpinLock::ScopedLockType lock(writeLock);
+        shadow[index] = value;
+
+        auto& slot = slots[1 - published.load(std::memory_order_relaxed)];
+        slot.sequence.fetch_add(1, std::memory_order_acq_rel);
+        for (int i = 0; i < numParameters; ++i)
+            slot.values[i].store(shadow[i], std::memory_order_relaxed);
+        slot.sequence.fetch_add(1, std::memory_order_release);
+
+        published.store(static_cast<int>(&slot - slots), std::memory_order_release);
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    // Audio thread. Copies the latest values into snapshot and returns true if anything
+    // was published since the snapshot was last filled.
+    bool acquire(ChordialParameterSnapshot& snapshot) const noexcept
+    {
+        const auto latest = version.load(std::memory_order_acquire);
+        if (latest == snapshot.version)
+            return false;
+
+        for (;;)
+        {
+            const auto& slot = slots[published.load(std::memory_order_acquire)];
+            const auto before = slot.sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0)
+                continue;
+
+            for (int i = 0; i < numParameters; ++i)
+                snapshot.values[i] = slot.values[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before)
+                break;
+        }
+
+        snapshot.version = latest;
+        return true;
+    }
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<juce::uint32> sequence{ 0 };
+        std::atomic<float> values[maxParameters];
+    };
+
+    Slot slots[2];
+    alignas(64) std::atomic<int> published{ 0 };
+    alignas(64) std::atomic<juce::uint32> version{ 0 };
+
+    juce::SpinLock writeLock;
+    float shadow[maxParameters] = {};
+    int numParameters{ 0 };
+    juce::StringArray ids;
+};
+
+}
+}
@@ -0,0 +1,257 @@
+/*
+  ==============================================================================
+
+    ChordialPerfCounters.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+// One timing or event, as recorded on the audio thread
+struct ChordialPerfSample
+{
+    juce::uint64 value; // high resolution ticks for timings, a count or level otherwise
+    juce::uint32 counter;
+};
+
+/*  Single producer, single consumer ring of preallocated events. The producer is whichever
+    thread is rendering into it (ChordialThreadPool's batch barrier orders successive
+    producers), the consumer drains it from a non-audio thread. A full ring drops events and
+    counts them rather than block the audio thread.
+*/
+template <typename EventType>
+class ChordialEventRing
+{
+public:
+    // Not real-time safe. capacity is rounded up to a power of two.
+    void allocate(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        events.reset(new EventType[size]);
+        mask = size - 1;
+        head.store(0);
+        tail.store(0);
+        dropped.store(0);
+    }
+
+    bool isAllocated() const noexcept { return events != nullptr; }
+
+    // Producer
+    void push(const EventType& event) noexcept
+    {
+        const auto position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) > mask)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        events[position & mask] = event;
+        head.store(position + 1, std::memory_order_release);
+    }
+
+    // Consumer. Calls function(event) for everything pushed so far.
+    template <typename Function>
+    void popAll(Function&& function)
+    {
+        const auto end = head.load(std::memory_order_acquire);
+        auto position = tail.load(std::memory_order_relaxed);
+
+        for (; position != end; ++position)
+            function(events[position & mask]);
+
+        tail.store(position, std::memory_order_release);
+    }
+
+    juce::uint64 getNumDropped() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<EventType[]> events;
+    size_t mask{ 0 };
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    std::atomic<juce::uint64> dropped{ 0 };
+};
+
+using ChordialPerfRing = ChordialEventRing<ChordialPerfSample>;
+
+/*  Audio thread instrumentation for ChordialSynthesiser, compiled in with
+    CHORDIAL_PERF_COUNTERS=1.
+
+    Ring 0 belongs to the audio thread; with parallel rendering ring b + 1 belongs to voice
+    bucket b. Call drain() from one non-audio thread (a UI timer, say) often enough to keep
+    the rings from filling, then read the aggregates with getStats(). Timings are in
+    microseconds, histogram bin 0 counts values below 1 and bin i values in [2^(i-1), 2^i).
+*/
+class ChordialPerfCounters
+{
+public:
+    enum Counter
+    {
+        synthBlock,       // one renderVoices() call, between MIDI events
+        controlTick,      // global LFO and modulation matrix
+        voiceOscillators, // one voice's oscillator stage over a control sub-block
+        voiceFilter,
+        voiceDCA,
+        voiceStart,       // events
+        voiceSteal,       // events
+        activeVoices,     // voices rendering, per control sub-block
+        numCounters
+    };
+
+    static constexpr int numHistogramBins = 20;
+    static constexpr size_t defaultRingCapacity = 16384;
+
+    struct Stats
+    {
+        juce::uint64 count{ 0 };
+        double total{ 0.0 };
+        double maximum{ 0.0 };
+        std::array<juce::uint64, numHistogramBins> histogram{};
+
+        double getMean() const noexcept { return count > 0 ? total / static_cast<double>(count) : 0.0; }
+    };
+
+    static constexpr bool isEnabled() noexcept { return CHORDIAL_PERF_COUNTERS != 0; }
+
+    static const char* getCounterName(Counter counter)
+    {
+        switch (counter)
+        {
+        case synthBlock: return "synth_block";
+        case controlTick: return "control_tick";
+        case voiceOscillators: return "voice_oscillators";
+        case voiceFilter: return "voice_filter";
+        case voiceDCA: return "voice_dca";
+        case voiceStart: return "voice_start";
+        case voiceSteal: return "voice_steal";
+        case activeVoices: return "active_voices";
+        default: jassertfalse; return "";
+        }
+    }
+
+    static bool isTiming(Counter counter) noexcept { return counter <= voiceDCA; }
+
+    // Not real-time safe, and not concurrently with drain(). Allocates nothing when the
+    // counters are compiled out.
+    void prepare(int numRings, size_t ringCapacity = defaultRingCapacity)
+    {
+        const juce::SpinLock::ScopedLockType lock(consumerLock);
+
+        rings.reset();
+        numRingsAllocated = 0;
+        if (!isEnabled())
+            return;
+
+        numRingsAllocated = juce::jmax(1, numRings);
+        rings.reset(new ChordialPerfRing[static_cast<size_t>(numRingsAllocated)]);
+        for (int i = 0; i < numRingsAllocated; ++i)
+            rings[i].allocate(ringCapacity);
+    }
+
+    // nullptr when compiled out or unprepared, so the recording macros can test for it
+    ChordialPerfRing* getRing(int index) noexcept
+    {
+        return juce::isPositiveAndBelow(index, numRingsAllocated) ? &rings[index] : nullptr;
+    }
+
+    // Moves everything recorded so far into the aggregates
+    void drain()
+    {
+        const juce::SpinLock::ScopedLockType lock(consumerLock);
+        const auto microsecondsPerTick = 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+
+        for (int i = 0; i < numRingsAllocated; ++i)
+        {
+            rings[i].popAll([this, microsecondsPerTick](const ChordialPerfSample& sample)
+            {
+                jassert(sample.counter < numCounters);
+                const auto counter = static_cast<Counter>(sample.counter);
+                const auto value = isTiming(counter) ? static_cast<double>(sample.value) * microsecondsPerTick
+                                                     : static_cast<double>(sample.value);
+                auto& stats = aggregates[sample.counter];
+                ++stats.count;
+                stats.total += value;
+                stats.maximum = juce::jmax(stats.maximum, value);
+                ++stats.histogram[static_cast<size_t>(getHistogramBin(value))];
+            });
+        }
+    }
+
+    Stats getStats(Counter counter) const
+    {
+        const juce::SpinLock::ScopedLockType lock(consumerLock);
+        return aggregates[counter];
+    }
+
+    juce::uint64 getNumDropped() const
+    {
+        const juce::SpinLock::ScopedLockType lock(consumerLock);
+        juce::uint64 dropped = 0;
+        for (int i = 0; i < numRingsAllocated; ++i)
+            dropped += rings[i].getNumDropped();
+        return dropped;
+    }
+
+    void resetStats()
+    {
+        const juce::SpinLock::ScopedLockType lock(consumerLock);
+        for (auto& stats : aggregates)
+            stats = {};
+    }
+
+    static int getHistogramBin(double value) noexcept
+    {
+        if (value < 1.0)
+            return 0;
+        return juce::jmin(numHistogramBins - 1, 1 + static_cast<int>(std::log2(value)));
+    }
+
+    // Records the ticks between construction and destruction
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(ChordialPerfRing* ring, Counter counter) noexcept
+            : ring(ring), counter(counter), start(ring != nullptr ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~ScopedTimer()
+        {
+            if (ring != nullptr)
+                ring->push({ static_cast<juce::uint64>(juce::Time::getHighResolutionTicks() - start), static_cast<juce::uint32>(counter) });
+        }
+
+    private:
+        ChordialPerfRing* ring;
+        Counter counter;
+        juce::int64 start;
+    };
+
+private:
+    std::unique_ptr<ChordialPerfRing[]> rings;
+    int numRingsAllocated{ 0 };
+    Stats aggregates[numCounters];
+    mutable juce::SpinLock consumerLock;
+};
+
+}
+}
+
+#if CHORDIAL_PERF_COUNTERS
+ #define CHORDIAL_PERF_SCOPE(ring, counter) \
+    const chordial::synth::ChordialPerfCounters::ScopedTimer JUCE_JOIN_MACRO(chordialPerfScope, __LINE__)(ring, chordial::synth::ChordialPerfCounters::counter)
+ #define CHORDIAL_PERF_EVENT(ring, counter, value) \
+    do { if (auto* chordialPerfRing = (ring)) chordialPerfRing->push({ static_cast<juce::uint64>(value), chordial::synth::ChordialPerfCounters::counter }); } while (false)
+#else
+ #define CHORDIAL_PERF_SCOPE(ring, counter)
+ #define CHORDIAL_PERF_EVENT(ring, counter, value) do {} while (false)
+#endif
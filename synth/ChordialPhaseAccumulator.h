@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    ChordialPhaseAccumulator.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Oscillator phase as an unsigned fraction of a cycle, 32 or 64 bits. Wrapping is integer
+    overflow, so the phase never drifts or needs a wrap loop however long a note is held,
+    and the normalised [0, 1) phase is one shift and one int to float conversion.
+
+    The increment is quantised to sampleRate / 2^bits (11 uHz at 48 kHz with 32 bits).
+    getPhaseAt() only adds and multiplies, so loops filling a block from a fixed increment
+    vectorize.
+*/
+template <typename PhaseType = juce::uint32>
+struct ChordialPhaseAccumulator
+{
+    static_assert(std::is_unsigned<PhaseType>::value, "The phase relies on unsigned wrapping");
+
+    static constexpr int numBits = std::numeric_limits<PhaseType>::digits;
+    // Half a cycle, e.g. the falling edge of a square
+    static constexpr PhaseType half = static_cast<PhaseType>(PhaseType(1) << (numBits - 1));
+
+    // Cycles per sample (frequency / sample rate) as an increment; whole cycles drop out
+    static PhaseType toIncrement(double cyclesPerSample) noexcept
+    {
+        // Through int64 the cast wraps, which is cheaper than std::floor where that's a call
+        if (numBits < 64)
+            return static_cast<PhaseType>(static_cast<juce::int64>(cyclesPerSample * std::ldexp(1.0, numBits)));
+
+        auto fraction = cyclesPerSample - std::floor(cyclesPerSample);
+        if (fraction >= 1.0)
+            fraction = 0.0;
+        return static_cast<PhaseType>(fraction * std::ldexp(1.0, numBits));
+    }
+
+    // The phase in [0, 1). Only as many top bits are kept as FloatType's mantissa holds, so
+    // the result is exact and never rounds up to 1.
+    template <typename FloatType>
+    static FloatType toNormalised(PhaseType value) noexcept
+    {
+        constexpr int digits = std::numeric_limits<FloatType>::digits;
+        constexpr int shift = numBits > digits ? numBits - digits : 0;
+        using Integer = typename std::conditional<(numBits - shift < 32), juce::int32, juce::int64>::type;
+
+        return static_cast<FloatType>(static_cast<Integer>(value >> shift))
+             * static_cast<FloatType>(std::ldexp(1.0, shift - numBits));
+    }
+
+    void setCyclesPerSample(double cyclesPerSample) noexcept { increment = toIncrement(cyclesPerSample); }
+
+    PhaseType getPhaseAt(size_t samplesAhead) const noexcept { return phase + static_cast<PhaseType>(samplesAhead) * increment; }
+    void advance(size_t numSamples = 1) noexcept { phase += static_cast<PhaseType>(numSamples) * increment; }
+    void reset() noexcept { phase = 0; }
+
+    template <typename FloatType>
+    FloatType getNormalisedPhase() const noexcept { return toNormalised<FloatType>(phase); }
+    template <typename FloatType>
+    FloatType getNormalisedIncrement() const noexcept { return toNormalised<FloatType>(increment); }
+
+    PhaseType phase{ 0 };
+    PhaseType increment{ 0 };
+};
+
+}
+}
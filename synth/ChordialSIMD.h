@@ -0,0 +1,268 @@
+/*
+  ==============================================================================
+
+    ChordialSIMD.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+#if JUCE_USE_SIMD
+template <typename SampleType>
+using ChordialSIMDRegister = juce::dsp::SIMDRegister<SampleType>;
+#else
+// Single lane stand-in with the subset of the juce::dsp::SIMDRegister interface
+// used by the Chordial kernels, for targets without SSE/AVX/NEON.
+template <typename SampleType>
+struct ChordialSIMDRegister
+{
+    struct vMaskType
+    {
+        bool value;
+        vMaskType operator~() const noexcept { return { !value }; }
+    };
+
+    static constexpr size_t SIMDNumElements = 1;
+    static constexpr size_t SIMDRegisterSize = sizeof(SampleType);
+
+    static ChordialSIMDRegister expand(SampleType s) noexcept { return { s }; }
+    static ChordialSIMDRegister fromRawArray(const SampleType* a) noexcept { return { *a }; }
+    void copyToRawArray(SampleType* a) const noexcept { *a = value; }
+    SampleType get(size_t) const noexcept { return value; }
+    void set(size_t, SampleType s) noexcept { value = s; }
+    SampleType sum() const noexcept { return value; }
+
+    ChordialSIMDRegister operator+(ChordialSIMDRegister o) const noexcept { return { value + o.value }; }
+    ChordialSIMDRegister operator-(ChordialSIMDRegister o) const noexcept { return { value - o.value }; }
+    ChordialSIMDRegister operator*(ChordialSIMDRegister o) const noexcept { return { value * o.value }; }
+    ChordialSIMDRegister operator+(SampleType s) const noexcept { return { value + s }; }
+    ChordialSIMDRegister operator-(SampleType s) const noexcept { return { value - s }; }
+    ChordialSIMDRegister operator*(SampleType s) const noexcept { return { value * s }; }
+    ChordialSIMDRegister& operator+=(ChordialSIMDRegister o) noexcept { value += o.value; return *this; }
+    ChordialSIMDRegister& operator-=(ChordialSIMDRegister o) noexcept { value -= o.value; return *this; }
+    ChordialSIMDRegister& operator*=(ChordialSIMDRegister o) noexcept { value *= o.value; return *this; }
+    ChordialSIMDRegister operator&(vMaskType m) const noexcept { return { m.value ? value : static_cast<SampleType>(0.0) }; }
+
+    static ChordialSIMDRegister min(ChordialSIMDRegister a, ChordialSIMDRegister b) noexcept { return { juce::jmin(a.value, b.value) }; }
+    static ChordialSIMDRegister max(ChordialSIMDRegister a, ChordialSIMDRegister b) noexcept { return { juce::jmax(a.value, b.value) }; }
+    static ChordialSIMDRegister multiplyAdd(ChordialSIMDRegister a, ChordialSIMDRegister b, ChordialSIMDRegister c) noexcept { return { a.value + b.value * c.value }; }
+
+    static vMaskType equal(ChordialSIMDRegister a, ChordialSIMDRegister b) noexcept { return { a.value == b.value }; }
+    static vMaskType lessThan(ChordialSIMDRegister a, ChordialSIMDRegister b) noexcept { return { a.value < b.value }; }
+    static vMaskType lessThanOrEqual(ChordialSIMDRegister a, ChordialSIMDRegister b) noexcept { return { a.value <= b.value }; }
+    static vMaskType greaterThan(ChordialSIMDRegister a, ChordialSIMDRegister b) noexcept { return { a.value > b.value }; }
+    static vMaskType greaterThanOrEqual(ChordialSIMDRegister a, ChordialSIMDRegister b) noexcept { return { a.value >= b.value }; }
+
+    SampleType value;
+};
+#endif
+
+namespace simd
+{
+    // Branch-free per-lane choice: a where mask is set, b elsewhere.
+    template <typename SampleType>
+    inline ChordialSIMDRegister<SampleType> select(typename ChordialSIMDRegister<SampleType>::vMaskType mask,
+                                                   ChordialSIMDRegister<SampleType> a,
+                                                   ChordialSIMDRegister<SampleType> b) noexcept
+    {
+        return (a & mask) + (b & ~mask);
+    }
+
+    template <typename SampleType>
+    inline ChordialSIMDRegister<SampleType> abs(ChordialSIMDRegister<SampleType> a) noexcept
+    {
+        const auto zero = ChordialSIMDRegister<SampleType>::expand(static_cast<SampleType>(0.0));
+        return ChordialSIMDRegister<SampleType>::max(a, zero - a);
+    }
+
+    // Reciprocal refined with two Newton steps from a previous estimate. Used where the
+    // divisor only drifts slowly (e.g. a smoothed phase increment), as SIMDRegister has no divide.
+    template <typename SampleType>
+    inline ChordialSIMDRegister<SampleType> refineReciprocal(ChordialSIMDRegister<SampleType> x,
+                                                             ChordialSIMDRegister<SampleType> estimate) noexcept
+    {
+        const auto two = ChordialSIMDRegister<SampleType>::expand(static_cast<SampleType>(2.0));
+        estimate = estimate * (two - x * estimate);
+        return estimate * (two - x * estimate);
+    }
+
+    // Branch-free PolyBLEP residual, t and dt normalised to one cycle
+    template <typename SampleType>
+    inline ChordialSIMDRegister<SampleType> polyBlep(ChordialSIMDRegister<SampleType> t, ChordialSIMDRegister<SampleType> dt,
+                                                     ChordialSIMDRegister<SampleType> inverseDt) noexcept
+    {
+        using Register = ChordialSIMDRegister<SampleType>;
+        const auto one = Register::expand(static_cast<SampleType>(1.0));
+        const auto rising = t * inverseDt;
+        const auto falling = (t - one) * inverseDt;
+
+        const auto start = (rising + rising - rising * rising - one) & Register::lessThan(t, dt);
+        const auto end = (falling * falling + falling + falling + one) & Register::greaterThan(t, one - dt);
+
+        return start + end;
+    }
+
+    // Copies channels [firstChannel, firstChannel + lanes) of a block to data laid out
+    // [sample][lane]. Lanes past the last channel are filled with silence.
+    template <typename SampleType>
+    inline void interleave(const juce::dsp::AudioBlock<SampleType>& block, size_t firstChannel, SampleType* data) noexcept
+    {
+        constexpr auto lanes = ChordialSIMDRegister<SampleType>::SIMDNumElements;
+        const auto numSamples = block.getNumSamples();
+        const auto numChannels = juce::jmin(lanes, block.getNumChannels() - firstChannel);
+
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            if (lane < numChannels)
+            {
+                const auto* input = block.getChannelPointer(firstChannel + lane);
+                for (size_t i = 0; i < numSamples; ++i)
+                    data[i * lanes + lane] = input[i];
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    data[i * lanes + lane] = static_cast<SampleType>(0.0);
+            }
+        }
+    }
+
+    // Inverse of interleave(), writing back only the lanes that map to channels of the block
+    template <typename SampleType>
+    inline void deinterleave(const SampleType* data, size_t firstChannel, const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        constexpr auto lanes = ChordialSIMDRegister<SampleType>::SIMDNumElements;
+        const auto numSamples = block.getNumSamples();
+        const auto numChannels = juce::jmin(lanes, block.getNumChannels() - firstChannel);
+
+        for (size_t lane = 0; lane < numChannels; ++lane)
+        {
+            auto* output = block.getChannelPointer(firstChannel + lane);
+            for (size_t i = 0; i < numSamples; ++i)
+                output[i] = data[i * lanes + lane];
+        }
+    }
+
+    // Adds the sum of each sample's lanes of data, laid out [sample][lane], to output. A
+    // pass over memory the compiler can vectorise, in place of a horizontal sum per sample.
+    // GCC only vectorises it at -O2 when asked to, and is slower than the horizontal sums
+    // without that.
+    template <typename SampleType>
+   #if JUCE_GCC
+    __attribute__((optimize("tree-vectorize", "vect-cost-model=dynamic")))
+   #endif
+    inline void addLanes(const SampleType* data, SampleType* output, size_t numSamples) noexcept
+    {
+        constexpr auto lanes = ChordialSIMDRegister<SampleType>::SIMDNumElements;
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto sum = data[i * lanes];
+            for (size_t lane = 1; lane < lanes; ++lane)
+                sum += data[i * lanes + lane];
+            output[i] += sum;
+        }
+    }
+}
+
+// Heap storage whose first element is aligned for ChordialSIMDRegister loads and stores.
+template <typename SampleType>
+class ChordialAlignedBuffer
+{
+public:
+    static constexpr size_t lanes = ChordialSIMDRegister<SampleType>::SIMDNumElements;
+
+    void allocate(size_t numElements)
+    {
+        size = roundUpToLanes(numElements);
+        heapBlock.allocate(size + lanes, true);
+        data = heapBlock.get();
+        while ((reinterpret_cast<juce::pointer_sized_int>(data) % ChordialSIMDRegister<SampleType>::SIMDRegisterSize) != 0)
+            ++data;
+    }
+
+    void clear()
+    {
+        if (data != nullptr)
+            std::fill(data, data + size, static_cast<SampleType>(0.0));
+    }
+
+    SampleType* get() const noexcept { return data; }
+    size_t getSize() const noexcept { return size; }
+    // Heap bytes held, alignment padding included
+    size_t getMemoryUsage() const noexcept { return data != nullptr ? (size + lanes) * sizeof(SampleType) : 0; }
+
+    static size_t roundUpToLanes(size_t numElements) noexcept
+    {
+        return ((numElements + lanes - 1) / lanes) * lanes;
+    }
+
+private:
+    juce::HeapBlock<SampleType> heapBlock;
+    SampleType* data{ nullptr };
+    size_t size{ 0 };
+};
+
+/*  Cache line aligned memory for buffers that only live while one voice renders, shared by
+    all the voices rendering one after another on a thread instead of each owning a copy.
+
+    A Carver hands out consecutive aligned regions of it. Given nullptr it only counts, so
+    the code that lays a region out can also size it.
+*/
+class ChordialScratchArena
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    class Carver
+    {
+    public:
+        explicit Carver(char* memory = nullptr) noexcept : base(memory) {}
+
+        template <typename Type>
+        Type* take(size_t numElements) noexcept
+        {
+            auto* region = base != nullptr ? reinterpret_cast<Type*>(base + used) : nullptr;
+            used += roundUp(numElements * sizeof(Type));
+            return region;
+        }
+
+        size_t getNumBytesUsed() const noexcept { return used; }
+
+    private:
+        char* base;
+        size_t used{ 0 };
+    };
+
+    static size_t roundUp(size_t numBytes) noexcept
+    {
+        return ((numBytes + alignment - 1) / alignment) * alignment;
+    }
+
+    // Not real-time safe
+    void allocate(size_t numBytes)
+    {
+        size = roundUp(numBytes);
+        heapBlock.allocate(size + alignment, true);
+        data = heapBlock.get();
+        while ((reinterpret_cast<juce::pointer_sized_int>(data) % alignment) != 0)
+            ++data;
+    }
+
+    char* get() const noexcept { return data; }
+    size_t getSize() const noexcept { return size; }
+    size_t getMemoryUsage() const noexcept { return data != nullptr ? size + alignment : 0; }
+
+private:
+    juce::HeapBlock<char> heapBlock;
+    char* data{ nullptr };
+    size_t size{ 0 };
+};
+
+}
+}
@@ -54,29 +54,43 @@ chordial::synth::ChordialSynthesiser::ChordialSynthesiser(juce::AudioProcessorVa
 	*/
 
 	// INIT PARAMETERS
-	auto initParam = [&](const juce::String& paramId, const juce::String& label, float rangeStart, float rangeEnd, float defaultValue, float interval = 0.0f, float skew = 1.0f)
+	auto initParam = [&](Parameter parameter, const juce::String& paramId, const juce::String& label, float rangeStart, float rangeEnd, float defaultValue, float interval = 0.0f, float skew = 1.0f)
 	{
 		apvtState.createAndAddParameter(paramId, label, juce::String(), juce::NormalisableRange<float>(rangeStart, rangeEnd, interval, skew), defaultValue, nullptr, nullptr);
-		apvtState.addParameterListener(paramId, this);
-	};
 
-	initParam(ADSR1_ATTACK_PARAM, "Attack", 1.0f, 500.0f, masterADSR1.getAttackTimeMs());
-	initParam(ADSR1_DECAY_PARAM, "Decay", 1.0f, 10000.0f, masterADSR1.getDecayTimeMs());
-	initParam(ADSR1_SUSTAIN_PARAM, "Sustain", 0.0f, 1.0f, masterADSR1.getSustainValue());
-	initParam(ADSR1_RELEASE_PARAM, "Release", 3.0f, 10000.0f, masterADSR1.getReleaseTimeMs());
+		const auto index = parameters.add(paramId, defaultValue);
+		jassert(index == static_cast<int>(parameter));
+		appliedParameters[index] = defaultValue;
 
-	initParam(ADSR2_ATTACK_PARAM, "Attack", 1.0f, 500.0f, masterADSR2.getAttackTimeMs());
-	initParam(ADSR2_DECAY_PARAM, "Decay", 1.0f, 10000.0f, masterADSR2.getDecayTimeMs());
-	initParam(ADSR2_SUSTAIN_PARAM, "Sustain", 0.0f, 1.0f, masterADSR2.getSustainValue());
-	initParam(ADSR2_RELEASE_PARAM, "Release", 3.0f, 10000.0f, masterADSR2.getReleaseTimeMs());
+		parameterListeners.push_back(std::make_unique<ParameterListener>(parameters, index));
+		apvtState.addParameterListener(paramId, parameterListeners.back().get());
+	};
 
-	initParam(LFO_AMT_PARAM, "LFO Amount", 0.0f, 0.5f, masterOscillator->getFrequencyModulationDepth(), 0.0f, 0.5f);
-	initParam(LFO_FREQ_PARAM, "LFO Frequency", 0.1f, 30.0f, lfo1.getBaseFrequency());
-	initParam(DETUNE_AMT_PARAM, "Detune", 0.000001f, 0.05f, masterOscillator->getDetuneAmount());
-	initParam(SPREAD_PARAM, "Panoramic Spread", 0.0f, 1.0f, masterOscillator->getPanoramicSpread());
-	initParam(FILTER_CUTOFF_PARAM, "Cutoff", 20.0f, 20000.0f, masterFilter->getCutoff(), 0.0f, 0.199f);
-	initParam(FILTER_RESONANCE_PARAM, "Resonance", 0.0f, 1.0f, masterFilter->getResonance());
-	initParam(FILTER_CUTOFF_MOD_DEPTH_PARAM, "Cutoff Mod (Env2)", 0.0f, 8.0f, masterFilter->getCutoffModDepth());
+	initParam(Parameter::adsr1Attack, ADSR1_ATTACK_PARAM, "Attack", 1.0f, 500.0f, masterADSR1.getAttackTimeMs());
+	initParam(Parameter::adsr1Decay, ADSR1_DECAY_PARAM, "Decay", 1.0f, 10000.0f, masterADSR1.getDecayTimeMs());
+	initParam(Parameter::adsr1Sustain, ADSR1_SUSTAIN_PARAM, "Sustain", 0.0f, 1.0f, masterADSR1.getSustainValue());
+	initParam(Parameter::adsr1Release, ADSR1_RELEASE_PARAM, "Release", 3.0f, 10000.0f, masterADSR1.getReleaseTimeMs());
+
+	initParam(Parameter::adsr2Attack, ADSR2_ATTACK_PARAM, "Attack", 1.0f, 500.0f, masterADSR2.getAttackTimeMs());
+	initParam(Parameter::adsr2Decay, ADSR2_DECAY_PARAM, "Decay", 1.0f, 10000.0f, masterADSR2.getDecayTimeMs());
+	initParam(Parameter::adsr2Sustain, ADSR2_SUSTAIN_PARAM, "Sustain", 0.0f, 1.0f, masterADSR2.getSustainValue());
+	initParam(Parameter::adsr2Release, ADSR2_RELEASE_PARAM, "Release", 3.0f, 10000.0f, masterADSR2.getReleaseTimeMs());
+
+	initParam(Parameter::lfoAmount, LFO_AMT_PARAM, "LFO Amount", 0.0f, 0.5f, masterOscillator->getFrequencyModulationDepth(), 0.0f, 0.5f);
+	initParam(Parameter::lfoFrequency, LFO_FREQ_PARAM, "LFO Frequency", 0.1f, 30.0f, lfo1.getBaseFrequency());
+	initParam(Parameter::detuneAmount, DETUNE_AMT_PARAM, "Detune", 0.000001f, 0.05f, masterOscillator->getDetuneAmount());
+	initParam(Parameter::panSpread, SPREAD_PARAM, "Panoramic Spread", 0.0f, 1.0f, masterOscillator->getPanoramicSpread());
+	initParam(Parameter::filterCutoff, FILTER_CUTOFF_PARAM, "Cutoff", 20.0f, 20000.0f, masterFilter->getCutoff(), 0.0f, 0.199f);
+	initParam(Parameter::filterResonance, FILTER_RESONANCE_PARAM, "Resonance", 0.0f, 1.0f, masterFilter->getResonance());
+	initParam(Parameter::filterCutoffModDepth, FILTER_CUTOFF_MOD_DEPTH_PARAM, "Cutoff Mod (Env2)", 0.0f, 8.0f, masterFilter->getCutoffModDepth());
+
+	parameters.acquire(parameterSnapshot);
+}
+
+chordial::synth::ChordialSynthesiser::~ChordialSynthesiser()
+{
+	for (int i = 0; i < parameters.getNumParameters(); ++i)
+		apvtState.removeParameterListener(parameters.getParameterID(i), parameterListeners[static_cast<size_t>(i)].get());
 }
 
 void chordial::synth::ChordialSynthesiser::prepareToPlay(double sampleRate, int samplesPerBlock)
@@ -86,10 +100,43 @@ void chordial::synth::ChordialSynthesiser::prepareToPlay(double sampleRate, int
 	spec.maximumBlockSize = samplesPerBlock;
 	spec.numChannels = 2;
 
-	for (auto voice : voices)
+	controlRate = controlRateHz > 0.0
+		? static_cast<size_t>(juce::jmax(1, juce::roundToInt(sampleRate / controlRateHz)))
+		: requestedControlRate;
+	controlUpdateCounter = controlRate;
+
+	// Voice i renders in bucket i % numBuckets, so each bucket's voices can share one arena
+	const auto numBuckets = renderPool != nullptr ? juce::jmax(1, juce::jmin(getNumVoices(), renderPool->getNumThreads() * 4)) : 0;
+	preparedScheduling = voiceScheduling;
+	const auto stageBatched = preparedScheduling == VoiceScheduling::stageMajor;
+	scratchArenas.clear();
+	scratchArenas.resize(static_cast<size_t>(juce::jmax(1, numBuckets)));
+	for (auto& arena : scratchArenas)
+		arena.allocate(juce::jmax(ChordialVoice::getScratchSize(spec, voiceSignalPath, stageBatched),
+		                          stageBatched ? ChordialFilterBank<float>::getScratchSize(spec) : 0));
+	preparedSpec = spec;
+
+	filterBanks.clear();
+	filterBanks.resize(stageBatched ? scratchArenas.size() : 0);
+	for (size_t i = 0; i < filterBanks.size(); ++i)
 	{
-		if (auto cv = dynamic_cast<ChordialVoice*>(voice))
+		filterBanks[i].setScratch(scratchArenas[i].get());
+		filterBanks[i].prepare(spec, static_cast<size_t>(voices.size()));
+	}
+
+	chordialVoices.clear();
+	for (int i = 0; i < voices.size(); ++i)
+	{
+		if (auto cv = dynamic_cast<ChordialVoice*>(voices.getUnchecked(i)))
+		{
+			chordialVoices.push_back(cv);
+			cv->setControlRate(controlRate, adaptiveControlRate);
+			cv->setSignalPath(voiceSignalPath);
+			cv->setUnisonVoices(unisonVoices);
+			cv->setStageBatched(stageBatched);
+			cv->setScratchArena(&scratchArenas[static_cast<size_t>(numBuckets > 0 ? i % numBuckets : 0)]);
 			cv->prepare(spec);
+		}
 	}
 
 	setCurrentPlaybackSampleRate(sampleRate);
@@ -100,8 +147,50 @@ void chordial::synth::ChordialSynthesiser::prepareToPlay(double sampleRate, int
 
 	lfo1.prepare({ downSampleRate, spec.maximumBlockSize, 1 });
 
-	masterADSR1.setSampleRate(downSampleRate);
-	masterADSR2.setSampleRate(downSampleRate);
+	if (oscillatorBank != nullptr)
+	{
+		oscillatorBank->prepare(spec);
+		oscillatorBank->setSamplesPerControlSignal(controlRate);
+	}
+
+	voiceBuckets.clear();
+	voiceBuckets.resize(static_cast<size_t>(numBuckets));
+	for (auto& bucket : voiceBuckets)
+		bucket.setSize(static_cast<int>(spec.numChannels), samplesPerBlock);
+
+	masterADSR1.setSampleRate(spec.sampleRate, static_cast<int>(controlRate));
+	masterADSR2.setSampleRate(spec.sampleRate, static_cast<int>(controlRate));
+
+	// One ring and trace lane for the audio thread and one per bucket, matching the voices'
+	// bucket assignment
+	perfCounters.prepare(1 + numBuckets);
+	tracer.prepare(1 + numBuckets);
+	audioThreadPerfRing = perfCounters.getRing(0);
+	audioThreadTraceLane = tracer.getLane(0);
+	for (int i = 0; i < voices.size(); ++i)
+	{
+		if (auto cv = dynamic_cast<ChordialVoice*>(voices.getUnchecked(i)))
+		{
+			const auto ring = numBuckets > 0 ? 1 + i % numBuckets : 0;
+			cv->setPerfRing(perfCounters.getRing(ring));
+			cv->setTraceLane(tracer.getLane(ring), i);
+		}
+	}
+}
+
+void chordial::synth::ChordialSynthesiser::setControlRate(int samplesPerControlSignal, bool adaptive)
+{
+	jassert(samplesPerControlSignal > 0);
+	requestedControlRate = static_cast<size_t>(juce::jmax(1, samplesPerControlSignal));
+	controlRateHz = 0.0;
+	adaptiveControlRate = adaptive;
+}
+
+void chordial::synth::ChordialSynthesiser::setControlRateHz(double ticksPerSecond, bool adaptive)
+{
+	jassert(ticksPerSecond > 0.0);
+	controlRateHz = ticksPerSecond;
+	adaptiveControlRate = adaptive;
 }
 
 void chordial::synth::ChordialSynthesiser::setNumberOfVoices(int num)
@@ -110,69 +199,186 @@ void chordial::synth::ChordialSynthesiser::setNumberOfVoices(int num)
 	while (num != currentNumVoices)
 	{
 		if (num < currentNumVoices)
+		{
+			if (auto cv = dynamic_cast<ChordialVoice*>(getVoice(currentNumVoices - 1)))
+			{
+				voiceManager.remove(cv->getManagerNode());
+				chordialVoices.erase(std::remove(chordialVoices.begin(), chordialVoices.end(), cv), chordialVoices.end());
+			}
 			removeVoice(currentNumVoices - 1);
+		}
 		else
 		{
 			auto voice = std::make_unique<ChordialVoice>(matrixCoreVoice, masterOscillator, masterFilter, masterADSR1, masterADSR2);
+			if (oscillatorBank != nullptr)
+				voice->setOscillatorBank(oscillatorBank, currentNumVoices * ChordialOscillatorBank<float>::oscillatorsPerVoice);
+			voiceManager.add(voice->getManagerNode());
+			voice->setVoiceManager(&voiceManager);
 			addVoice(voice.release());
 		}
 
 		currentNumVoices = getNumVoices();
 	}
+
+	if (oscillatorBank != nullptr)
+		oscillatorBank->setNumVoices(num);
 }
 
-juce::SynthesiserVoice* chordial::synth::ChordialSynthesiser::findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int midiChannel, int midiNoteNumber) const
+void chordial::synth::ChordialSynthesiser::setOscillatorBankEnabled(bool shouldUseBank)
 {
-	jassert(!voices.isEmpty());
+	if (shouldUseBank == (oscillatorBank != nullptr))
+		return;
 
-	// this is a list of voices we can steal, sorted by how long they've been running
-	juce::Array<juce::SynthesiserVoice*> usableVoices;
-	usableVoices.ensureStorageAllocated(voices.size());
+	if (shouldUseBank)
+	{
+		oscillatorBank = std::make_shared<ChordialOscillatorBank<float>>();
+		oscillatorBank->setMasterOscillator(masterOscillator);
+		oscillatorBank->setNumVoices(getNumVoices());
+	}
+	else
+	{
+		oscillatorBank = nullptr;
+	}
 
+	for (int i = 0; i < getNumVoices(); ++i)
+	{
+		if (auto cv = dynamic_cast<ChordialVoice*>(getVoice(i)))
+			cv->setOscillatorBank(oscillatorBank, i * ChordialOscillatorBank<float>::oscillatorsPerVoice);
+	}
+}
+
+void chordial::synth::ChordialSynthesiser::setFilterEngine(ChordialFilterMaster<float>::Engine engine)
+{
+	masterFilter->setEngine(engine);
+}
+
+void chordial::synth::ChordialSynthesiser::setFilterOversampling(int factorLog2, bool adaptive)
+{
+	masterFilter->setOversamplingFactor(factorLog2);
+	masterFilter->setAdaptiveOversampling(adaptive);
+}
+
+void chordial::synth::ChordialSynthesiser::setAudioRateEnvelopes(bool shouldUseAudioRate)
+{
 	for (auto* voice : voices)
 	{
-		if (voice->canPlaySound(soundToPlay))
-		{
-			jassert(voice->isVoiceActive()); // We wouldn't be here otherwise
+		if (auto cv = dynamic_cast<ChordialVoice*>(voice))
+			cv->setAudioRateEnvelopes(shouldUseAudioRate);
+	}
 
-			usableVoices.add(voice);
+	// Envelope rows into destinations without a per-sample input stay at control rate
+	const auto rate = shouldUseAudioRate ? ChordialModMatrixCore::Rate::audio : ChordialModMatrixCore::Rate::control;
+	const auto rows = matrixCoreVoice->getRows();
+	for (size_t i = 0; i < rows.size(); ++i)
+	{
+		if (rows[i].source == VOICE_ADSR1_OUT && rows[i].destination == VOICE_DCA_GAIN_IN)
+			matrixCoreVoice->setRowRate(i, rate);
+	}
+}
 
-			// NB: Using a functor rather than a lambda here due to scare-stories about
-			// compilers generating code containing heap allocations..
-			struct Sorter
-			{
-				bool operator() (const juce::SynthesiserVoice* a, const juce::SynthesiserVoice* b) const noexcept { return a->wasStartedBefore(*b); }
-			};
+void chordial::synth::ChordialSynthesiser::setVoiceRetirementThreshold(float decibels)
+{
+	const auto gain = juce::Decibels::decibelsToGain(decibels);
+	for (auto* voice : voices)
+	{
+		if (auto cv = dynamic_cast<ChordialVoice*>(voice))
+			cv->setRetirementThreshold(gain);
+	}
+}
 
-			std::sort(usableVoices.begin(), usableVoices.end(), Sorter());
-		}
+chordial::synth::ChordialSynthesiser::RenderStats chordial::synth::ChordialSynthesiser::getRenderStats() const
+{
+	RenderStats stats{ renderedVoiceBlocks.load(), skippedVoiceBlocks.load(), 0 };
+	for (auto* voice : voices)
+	{
+		if (auto cv = dynamic_cast<const ChordialVoice*>(voice))
+			stats.retiredNotes += cv->getNumRetiredNotes();
 	}
+	return stats;
+}
+
+chordial::synth::ChordialSynthesiser::MemoryReport chordial::synth::ChordialSynthesiser::getMemoryReport() const
+{
+	MemoryReport report{ voices.size(), 0, ChordialVoice::getUnsharedScratchSize(preparedSpec, voiceSignalPath, preparedScheduling == VoiceScheduling::stageMajor), static_cast<int>(scratchArenas.size()), 0 };
+	for (auto* voice : voices)
+	{
+		if (auto cv = dynamic_cast<const ChordialVoice*>(voice))
+			report.bytesPerVoice = juce::jmax(report.bytesPerVoice, cv->getMemoryUsage());
+	}
+	for (auto& arena : scratchArenas)
+		report.scratchArenaBytes += arena.getMemoryUsage();
+	return report;
+}
+
+chordial::synth::ChordialPerfCounters::Stats chordial::synth::ChordialSynthesiser::getPerformanceStats(ChordialPerfCounters::Counter counter)
+{
+	perfCounters.drain();
+	return perfCounters.getStats(counter);
+}
 
-	// The oldest note that's playing with the target pitch is ideal..
-	for (auto* voice : usableVoices)
-		if (voice->getCurrentlyPlayingNote() == midiNoteNumber)
-			return voice;
+void chordial::synth::ChordialSynthesiser::setNumberOfRenderThreads(int numThreads)
+{
+	if (numThreads > 1)
+		renderPool = std::make_unique<ChordialThreadPool>(numThreads - 1);
+	else
+		renderPool = nullptr;
+}
+
+void chordial::synth::ChordialSynthesiser::noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff)
+{
+	juce::Synthesiser::noteOff(midiChannel, midiNoteNumber, velocity, allowTailOff);
 
-	// Oldest voice that has been released (no finger on it and not held by sustain pedal)
-	for (auto* voice : usableVoices)
-		if (voice->isPlayingButReleased())
-			return voice;
+	// Voices held by a pedal lift their key without a stopNote()
+	voiceManager.updateNote(midiNoteNumber);
+}
+
+void chordial::synth::ChordialSynthesiser::handleSustainPedal(int midiChannel, bool isDown)
+{
+	juce::Synthesiser::handleSustainPedal(midiChannel, isDown);
+	voiceManager.updateActive();
+}
 
-	// Oldest voice that doesn't have a finger on it:
-	for (auto* voice : usableVoices)
-		if (!voice->isKeyDown())
-			return voice;
+void chordial::synth::ChordialSynthesiser::handleSostenutoPedal(int midiChannel, bool isDown)
+{
+	juce::Synthesiser::handleSostenutoPedal(midiChannel, isDown);
+	voiceManager.updateActive();
+}
 
-	// Oldest voice that isn't protected
-	for (auto* voice : usableVoices)
+juce::SynthesiserVoice* chordial::synth::ChordialSynthesiser::findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+	if (auto* voice = voiceManager.getFreeVoice())
+	{
+		jassert(voice->canPlaySound(soundToPlay)); // Every ChordialVoice plays every ChordialSound
+		juce::ignoreUnused(soundToPlay);
 		return voice;
+	}
+
+	return stealIfNoneAvailable ? findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber) : nullptr;
+}
+
+juce::SynthesiserVoice* chordial::synth::ChordialSynthesiser::findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int midiChannel, int midiNoteNumber) const
+{
+	jassert(!voices.isEmpty());
+
+	CHORDIAL_PERF_EVENT(audioThreadPerfRing, voiceSteal, 1);
+	CHORDIAL_TRACE_INSTANT(audioThreadTraceLane, "voiceSteal", -1, midiNoteNumber);
 
-	jassert(false);
-	return nullptr;
+	// Oldest voice on this note, else oldest released, else oldest with no key down, else oldest
+	auto* voice = voiceManager.getVoiceToSteal(midiNoteNumber);
+	jassert(voice != nullptr && voice->canPlaySound(soundToPlay));
+	juce::ignoreUnused(soundToPlay, midiChannel);
+	return voice;
 }
 
 void chordial::synth::ChordialSynthesiser::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
 {
+	// Release tails decay towards zero through the filters, keep them out of denormal range
+	juce::ScopedNoDenormals noDenormals;
+	CHORDIAL_PERF_SCOPE(audioThreadPerfRing, synthBlock);
+	CHORDIAL_TRACE_SCOPE(audioThreadTraceLane, "renderVoices", -1, numSamples);
+
+	applyParameters();
+
 	while (numSamples)
 	{
 		auto max = juce::jmin(static_cast<size_t> (numSamples), controlUpdateCounter);
@@ -181,57 +387,178 @@ void chordial::synth::ChordialSynthesiser::renderVoices(juce::AudioBuffer<float>
 
 		if (controlUpdateCounter == 0)
 		{
+			CHORDIAL_PERF_SCOPE(audioThreadPerfRing, controlTick);
+			CHORDIAL_TRACE_SCOPE(audioThreadTraceLane, "controlTick", -1, -1);
 			controlUpdateCounter = controlRate;
 			lfo1.updateOscillatorFrequency(true);
 			lfo1.processSample();
 			modMatrixGlobal.process();
 		}
 
+		auto numActiveVoices = 0;
 		for (auto* voice : voices)
-			voice->renderNextBlock(outputAudio, startSample, max);
+			if (voice->isVoiceActive())
+				++numActiveVoices;
+
+		renderedVoiceBlocks.fetch_add(static_cast<juce::uint64>(numActiveVoices), std::memory_order_relaxed);
+		skippedVoiceBlocks.fetch_add(static_cast<juce::uint64>(voices.size() - numActiveVoices), std::memory_order_relaxed);
+		CHORDIAL_PERF_EVENT(audioThreadPerfRing, activeVoices, numActiveVoices);
+
+		// Idle fast path: the global modulation above keeps running, nothing else does
+		if (numActiveVoices > 0)
+		{
+			if (oscillatorBank != nullptr)
+			{
+				for (auto* voice : voices)
+				{
+					if (auto cv = dynamic_cast<ChordialVoice*>(voice))
+						cv->updateOscillatorBank();
+				}
+				oscillatorBank->process(max);
+			}
+
+			if (renderPool != nullptr && !voiceBuckets.empty())
+				renderVoicesInParallel(outputAudio, startSample, static_cast<int>(max));
+			else if (rendersStageMajor())
+				renderVoiceStages(outputAudio, startSample, static_cast<int>(max), 0, 1, audioThreadTraceLane);
+			else
+				for (auto* voice : voices)
+					if (voice->isVoiceActive())
+						voice->renderNextBlock(outputAudio, startSample, max);
+		}
 
 		numSamples -= max;
 		startSample += max;
 
 	}
 
+	// Voices that finished or retired while rendering become free
+	voiceManager.updateActive();
+
 	/*auto block = juce::dsp::AudioBlock<float>(buffer);
 	auto contextToUse = juce::dsp::ProcessContextReplacing<float>(block);
 	fxChain.process(contextToUse);*/
 }
 
-void chordial::synth::ChordialSynthesiser::parameterChanged(const juce::String & parameterID, float newValue)
-{
-	if (parameterID == ADSR1_ATTACK_PARAM)
-		masterADSR1.setAttackTimeMs(newValue);
-	else if (parameterID == ADSR1_DECAY_PARAM)
-		masterADSR1.setDecayTimeMs(newValue);
-	else if (parameterID == ADSR1_SUSTAIN_PARAM)
-		masterADSR1.setSustainValue(newValue);
-	else if (parameterID == ADSR1_RELEASE_PARAM)
-		masterADSR1.setReleaseTimeMs(newValue);
-
-	else if (parameterID == ADSR2_ATTACK_PARAM)
-		masterADSR2.setAttackTimeMs(newValue);
-	else if (parameterID == ADSR2_DECAY_PARAM)
-		masterADSR2.setDecayTimeMs(newValue);
-	else if (parameterID == ADSR2_SUSTAIN_PARAM)
-		masterADSR2.setSustainValue(newValue);
-	else if (parameterID == ADSR2_RELEASE_PARAM)
-		masterADSR2.setReleaseTimeMs(newValue);
-
-	else if (parameterID == LFO_FREQ_PARAM)
-		lfo1.setBaseFrequencyWithoutUpdating(newValue);
-	else if (parameterID == LFO_AMT_PARAM)
-		masterOscillator->setFrequencyModulationDepth(newValue);
-	else if (parameterID == SPREAD_PARAM)
-		masterOscillator->setPanoramicSpread(newValue);
-	else if (parameterID == DETUNE_AMT_PARAM)
-		masterOscillator->setDetuneAmount(newValue);
-	else if (parameterID == FILTER_CUTOFF_PARAM)
-		masterFilter->setCutoff(newValue);
-	else if (parameterID == FILTER_RESONANCE_PARAM)
-		masterFilter->setResonance(newValue);
-	else if (parameterID == FILTER_CUTOFF_MOD_DEPTH_PARAM)
-		masterFilter->setCutoffModDepth(newValue);
+void chordial::synth::ChordialSynthesiser::renderVoicesInParallel(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+	bucketStartSample = startSample;
+	bucketNumSamples = numSamples;
+
+	renderPool->run(static_cast<int>(voiceBuckets.size()), [](void* context, int bucket)
+	{
+		static_cast<ChordialSynthesiser*>(context)->renderVoiceBucket(bucket);
+	}, this);
+
+	const auto numChannels = juce::jmin(outputAudio.getNumChannels(), voiceBuckets.front().getNumChannels());
+	for (auto& bucket : voiceBuckets)
+		for (int channel = 0; channel < numChannels; ++channel)
+			outputAudio.addFrom(channel, startSample, bucket, channel, startSample, numSamples);
+}
+
+void chordial::synth::ChordialSynthesiser::renderVoiceBucket(int bucket)
+{
+	auto& buffer = voiceBuckets[static_cast<size_t>(bucket)];
+	buffer.clear(bucketStartSample, bucketNumSamples);
+
+	const auto numBuckets = static_cast<int>(voiceBuckets.size());
+	if (rendersStageMajor())
+	{
+		renderVoiceStages(buffer, bucketStartSample, bucketNumSamples, bucket, numBuckets, tracer.getLane(1 + bucket));
+		return;
+	}
+
+	for (int i = bucket; i < voices.size(); i += numBuckets)
+		if (voices.getUnchecked(i)->isVoiceActive())
+			voices.getUnchecked(i)->renderNextBlock(buffer, bucketStartSample, bucketNumSamples);
+}
+
+bool chordial::synth::ChordialSynthesiser::rendersStageMajor() const noexcept
+{
+	// Voices prepared for stage-major keep their mix off the shared arena, and each bucket has a filter bank
+	jassert(preparedScheduling != VoiceScheduling::stageMajor || !filterBanks.empty());
+	return preparedScheduling == VoiceScheduling::stageMajor && !filterBanks.empty();
+}
+
+void chordial::synth::ChordialSynthesiser::renderVoiceStages(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, int first, int step, ChordialTraceLane* lane)
+{
+	juce::ignoreUnused(lane);
+	const auto numVoices = static_cast<int>(chordialVoices.size());
+
+	for (int i = first; i < numVoices; i += step)
+		if (chordialVoices[static_cast<size_t>(i)]->isVoiceActive())
+			chordialVoices[static_cast<size_t>(i)]->beginBlock(buffer, startSample, numSamples);
+
+	// Voices tick on their own schedules, so each round takes every voice one control
+	// sub-block further, whatever its length, until none has any left
+	for (;;)
+	{
+		auto anySegments = false;
+		for (int i = first; i < numVoices; i += step)
+			anySegments = chordialVoices[static_cast<size_t>(i)]->beginSegment() || anySegments;
+
+		if (!anySegments)
+			break;
+
+		{
+			CHORDIAL_TRACE_SCOPE(lane, "oscillatorStage", -1, numSamples);
+			for (int i = first; i < numVoices; i += step)
+				if (chordialVoices[static_cast<size_t>(i)]->isRenderingBlock())
+					chordialVoices[static_cast<size_t>(i)]->processOscillatorStage();
+		}
+		{
+			CHORDIAL_TRACE_SCOPE(lane, "filterStage", -1, numSamples);
+			auto& filterBank = filterBanks[static_cast<size_t>(first)];
+			for (int i = first; i < numVoices; i += step)
+				if (chordialVoices[static_cast<size_t>(i)]->isRenderingBlock())
+					chordialVoices[static_cast<size_t>(i)]->processFilterStage(filterBank);
+			filterBank.process();
+		}
+		{
+			CHORDIAL_TRACE_SCOPE(lane, "outputStage", -1, numSamples);
+			for (int i = first; i < numVoices; i += step)
+				if (chordialVoices[static_cast<size_t>(i)]->isRenderingBlock())
+					chordialVoices[static_cast<size_t>(i)]->processOutputStage();
+		}
+	}
+}
+
+void chordial::synth::ChordialSynthesiser::applyParameters()
+{
+	if (!parameters.acquire(parameterSnapshot))
+		return;
+
+	for (int i = 0; i < parameters.getNumParameters(); ++i)
+	{
+		if (parameterSnapshot[i] != appliedParameters[i])
+		{
+			appliedParameters[i] = parameterSnapshot[i];
+			applyParameter(static_cast<Parameter>(i), parameterSnapshot[i]);
+		}
+	}
+}
+
+void chordial::synth::ChordialSynthesiser::applyParameter(Parameter parameter, float newValue)
+{
+	switch (parameter)
+	{
+	case Parameter::adsr1Attack: masterADSR1.setAttackTimeMs(newValue); break;
+	case Parameter::adsr1Decay: masterADSR1.setDecayTimeMs(newValue); break;
+	case Parameter::adsr1Sustain: masterADSR1.setSustainValue(newValue); break;
+	case Parameter::adsr1Release: masterADSR1.setReleaseTimeMs(newValue); break;
+
+	case Parameter::adsr2Attack: masterADSR2.setAttackTimeMs(newValue); break;
+	case Parameter::adsr2Decay: masterADSR2.setDecayTimeMs(newValue); break;
+	case Parameter::adsr2Sustain: masterADSR2.setSustainValue(newValue); break;
+	case Parameter::adsr2Release: masterADSR2.setReleaseTimeMs(newValue); break;
+
+	case Parameter::lfoFrequency: lfo1.setBaseFrequencyWithoutUpdating(newValue); break;
+	case Parameter::lfoAmount: masterOscillator->setFrequencyModulationDepth(newValue); break;
+	case Parameter::panSpread: masterOscillator->setPanoramicSpread(newValue); break;
+	case Parameter::detuneAmount: masterOscillator->setDetuneAmount(newValue); break;
+	case Parameter::filterCutoff: masterFilter->setCutoff(newValue); break;
+	case Parameter::filterResonance: masterFilter->setResonance(newValue); break;
+	case Parameter::filterCutoffModDepth: masterFilter->setCutoffModDepth(newValue); break;
+	default: jassertfalse; break;
+	}
 }
@@ -22,34 +22,184 @@ namespace synth
 #define FILTER_RESONANCE_PARAM "filter_resonance"
 #define FILTER_CUTOFF_MOD_DEPTH_PARAM "filter_cutoff_mod_depth"
 
-class ChordialSynthesiser : public juce::Synthesiser,
-	private juce::AudioProcessorValueTreeState::Listener
+class ChordialSynthesiser : public juce::Synthesiser
 {
 public: 
 	ChordialSynthesiser(juce::AudioProcessorValueTreeState& apvtState);
+	~ChordialSynthesiser();
 	
 	void prepareToPlay(double sampleRate, int samplesPerBlock);
 	void setNumberOfVoices(int num);
+	// Samples between modulation updates (default 100), or updates per second, resolved
+	// against the sample rate in prepareToPlay. Adaptive lets each voice tick 4x as often
+	// while its envelopes are in attack/decay or moving quickly. The global LFO always ticks
+	// at the base rate. Not real-time safe, call before prepareToPlay.
+	void setControlRate(int samplesPerControlSignal, bool adaptive = false);
+	void setControlRateHz(double ticksPerSecond, bool adaptive = false);
+	size_t getControlRate() const noexcept { return controlRate; }
+	// Renders all voices' oscillators through one SIMD ChordialOscillatorBank.
+	// Not real-time safe, call before prepareToPlay.
+	void setOscillatorBankEnabled(bool shouldUseBank);
+	// Renders voices in parallel on numThreads - 1 workers plus the audio thread; 1 renders
+	// everything on the audio thread. Not real-time safe, call before prepareToPlay.
+	void setNumberOfRenderThreads(int numThreads);
+	// Selects the voices' ladder filter implementation. Real-time safe. chordialLadder only
+	// packs lanes across voices under VoiceScheduling::stageMajor; voice by voice, a stereo
+	// voice fills two lanes of a group and a mono voice one.
+	void setFilterEngine(ChordialFilterMaster<float>::Engine engine);
+	// Oversampling of the native filter engine, 0 (1x) to 3 (8x); adaptive lets each voice
+	// go lower where its cutoff, resonance and pitch allow. Real-time safe.
+	void setFilterOversampling(int factorLog2, bool adaptive);
+	// Renders the envelopes per sample rather than per control period, with the ADSR1 to DCA
+	// gain route at audio rate. Not real-time safe, call after setNumberOfVoices and before prepareToPlay.
+	void setAudioRateEnvelopes(bool shouldUseAudioRate);
+
+	// Mono runs each voice's filter and DCA on one channel and pans after them (see
+	// ChordialVoice::SignalPath); stereo, the default, filters both channels. Not real-time
+	// safe, call before prepareToPlay.
+	void setVoiceSignalPath(ChordialVoice::SignalPath path) { voiceSignalPath = path; }
+	// 1 to 16 renders each voice's oscillators as a unison stack of that many detuned, spread
+	// copies (see ChordialUnisonOscillator); 0, the default, as three oscillators or through the
+	// bank. Not real-time safe, call before prepareToPlay.
+	void setUnisonVoices(int numVoices) { unisonVoices = numVoices; }
+
+	// Order of the voices' work within a control sub-block. voiceMajor, the default, runs each
+	// voice's oscillators, filter and DCA before the next voice starts; stageMajor runs the
+	// oscillators of every active voice, then every filter, then every DCA. Its filter stage
+	// runs the chordialLadder engine's channels of all the voices together, packed into full
+	// SIMD lane groups by a ChordialFilterBank; the JUCE engine still filters voice by voice.
+	// The voices render the same either way; only the order their sub-blocks are summed in,
+	// and so float rounding, can differ. Takes effect at the next prepareToPlay, which sets
+	// the voices and filter banks up for it; rendering keeps to the prepared scheduling.
+	enum class VoiceScheduling
+	{
+		voiceMajor,
+		stageMajor
+	};
+	void setVoiceScheduling(VoiceScheduling scheduling) { voiceScheduling = scheduling; }
+
+	// Released voices stop rendering once their output stays below this level (default -100 dB;
+	// as with juce::Decibels, -100 or lower disables retirement). Real-time safe.
+	void setVoiceRetirementThreshold(float decibels);
+
+	// Voice-blocks are one voice over one control-rate sub-block
+	struct RenderStats
+	{
+		juce::uint64 renderedVoiceBlocks;
+		juce::uint64 skippedVoiceBlocks;
+		juce::uint64 retiredNotes;
+	};
+	RenderStats getRenderStats() const;
+
+	// Heap memory of the voices as of the last prepareToPlay. Render scratch used to be owned
+	// by every voice and module; it now lives in one arena per thread rendering voices.
+	struct MemoryReport
+	{
+		int numVoices;
+		size_t bytesPerVoice;              // owned by each voice, the voice object included
+		size_t unsharedScratchBytesPerVoice; // scratch each voice would own without the arenas
+		int numScratchArenas;
+		size_t scratchArenaBytes;          // all arenas together
+
+		size_t getTotalBytes() const { return static_cast<size_t>(numVoices) * bytesPerVoice + scratchArenaBytes; }
+		size_t getTotalBytesUnshared() const { return static_cast<size_t>(numVoices) * (bytesPerVoice + unsharedScratchBytesPerVoice); }
+	};
+	// Not real-time safe, and not during prepareToPlay
+	MemoryReport getMemoryReport() const;
+
+	// Aggregated audio thread timings and counts (see ChordialPerfCounters), all empty unless
+	// built with CHORDIAL_PERF_COUNTERS=1. Drains what the audio thread recorded since the last
+	// call first, so poll from one non-audio thread, and not during prepareToPlay.
+	ChordialPerfCounters::Stats getPerformanceStats(ChordialPerfCounters::Counter counter);
+	juce::uint64 getNumDroppedPerformanceSamples() const { return perfCounters.getNumDropped(); }
+	void resetPerformanceStats() { perfCounters.resetStats(); }
+
+	// Timeline of the audio thread and render workers (see ChordialTracer) as a Chrome trace
+	// event file, written from a background thread until stopTracing(). Returns false if the
+	// file can't be opened or the build lacks CHORDIAL_TRACE=1. Not real-time safe.
+	bool startTracing(const juce::File& file) { return tracer.start(file); }
+	void stopTracing() { tracer.stop(); }
+	bool isTracing() const noexcept { return tracer.isTracing(); }
+
+	// Routing cores, for editing rows (enable, depth, control/audio rate) from the UI
+	std::shared_ptr<ChordialModMatrixCore> getVoiceModMatrixCore() { return matrixCoreVoice; }
+	std::shared_ptr<ChordialModMatrixCore> getGlobalModMatrixCore() { return matrixCoreGlobal; }
 private:
 	enum class fxIndices
 	{
 		convolutionIndex
 	};
+
+	// Parameter registry indices, in registration order
+	enum class Parameter
+	{
+		adsr1Attack,
+		adsr1Decay,
+		adsr1Sustain,
+		adsr1Release,
+		adsr2Attack,
+		adsr2Decay,
+		adsr2Sustain,
+		adsr2Release,
+		lfoAmount,
+		lfoFrequency,
+		detuneAmount,
+		panSpread,
+		filterCutoff,
+		filterResonance,
+		filterCutoffModDepth,
+		numParameters
+	};
+
+	// Forwards one APVTS parameter to its registry index, so no ID strings are compared
+	struct ParameterListener : public juce::AudioProcessorValueTreeState::Listener
+	{
+		ParameterListener(ChordialParameterRegistry& registry, int index) : registry(registry), index(index) {}
+		void parameterChanged(const juce::String&, float newValue) override { registry.set(index, newValue); }
+
+		ChordialParameterRegistry& registry;
+		const int index;
+	};
 	
+	void noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override;
+	void handleSustainPedal(int midiChannel, bool isDown) override;
+	void handleSostenutoPedal(int midiChannel, bool isDown) override;
+	juce::SynthesiserVoice* findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const override;
 	juce::SynthesiserVoice* findVoiceToSteal(juce::SynthesiserSound *soundToPlay, int midiChannel, int midiNoteNumber) const override;
 	void renderVoices(juce::AudioBuffer< float > & 	outputAudio, int startSample, int numSamples) override;
+	void renderVoicesInParallel(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples);
+	void renderVoiceBucket(int bucket);
+	// Whether the last prepareToPlay set up stage-major rendering
+	bool rendersStageMajor() const noexcept;
+	// Stage-major rendering of voices first, first + step, ... into buffer
+	void renderVoiceStages(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, int first, int step, ChordialTraceLane* lane);
 
-	void parameterChanged(const juce::String &parameterID, float newValue) override;
+	// Audio thread: acquires the parameter snapshot and applies the values that changed
+	void applyParameters();
+	void applyParameter(Parameter parameter, float newValue);
 
 	juce::AudioProcessorValueTreeState& apvtState;
 
+	ChordialParameterRegistry parameters;
+	ChordialParameterSnapshot parameterSnapshot;
+	float appliedParameters[ChordialParameterSnapshot::maxParameters] = {};
+	std::vector<std::unique_ptr<ParameterListener>> parameterListeners;
+
 	juce::dsp::ProcessorChain<juce::dsp::Convolution> fxChain;
 
 	std::shared_ptr<ChordialOscillatorMaster<float>> masterOscillator;
 	std::shared_ptr<ChordialFilterMaster<float>> masterFilter;
+	std::shared_ptr<ChordialOscillatorBank<float>> oscillatorBank;
+
+	// Voice states for allocation and stealing, kept in step with the voices' flags
+	ChordialVoiceManager voiceManager;
 
-	static constexpr size_t controlRate = 100;
-	size_t controlUpdateCounter = controlRate;
+	static constexpr size_t defaultControlRate = 100;
+	size_t requestedControlRate = defaultControlRate;
+	double controlRateHz{ 0.0 };
+	bool adaptiveControlRate{ false };
+	size_t controlRate = defaultControlRate;
+	size_t controlUpdateCounter = defaultControlRate;
 
 	ChordialMasterADSR<float, float> masterADSR1;
 	ChordialMasterADSR<float, float> masterADSR2;
@@ -59,6 +209,36 @@ private:
 
 	std::shared_ptr<ChordialModMatrixCore> matrixCoreGlobal;
 	ChordialModMatrix<float> modMatrixGlobal;
+
+	// Parallel rendering: voice i always renders into bucket i % numBuckets and the buckets
+	// are summed in index order, so the output does not depend on thread scheduling
+	std::unique_ptr<ChordialThreadPool> renderPool;
+	std::vector<juce::AudioBuffer<float>> voiceBuckets;
+	int bucketStartSample = 0;
+	int bucketNumSamples = 0;
+
+	// Voice render scratch: arena 0 for the audio thread, or one per bucket as each renders
+	// its voices one after another
+	std::vector<ChordialScratchArena> scratchArenas;
+	// Stage-major filter banks, one per arena, which they share with its voices
+	std::vector<ChordialFilterBank<float>> filterBanks;
+	juce::dsp::ProcessSpec preparedSpec{ 44100.0, 0, 2 };
+	ChordialVoice::SignalPath voiceSignalPath{ ChordialVoice::SignalPath::stereo };
+	int unisonVoices{ 0 };
+	VoiceScheduling voiceScheduling{ VoiceScheduling::voiceMajor };
+	VoiceScheduling preparedScheduling{ VoiceScheduling::voiceMajor };
+	// The prepared voices as ChordialVoices, for stage-major rendering. Voices added since
+	// prepareToPlay join at the next one; removed voices leave at once.
+	std::vector<ChordialVoice*> chordialVoices;
+
+	std::atomic<juce::uint64> renderedVoiceBlocks{ 0 };
+	std::atomic<juce::uint64> skippedVoiceBlocks{ 0 };
+
+	ChordialPerfCounters perfCounters;
+	ChordialPerfRing* audioThreadPerfRing{ nullptr };
+
+	ChordialTracer tracer;
+	ChordialTraceLane* audioThreadTraceLane{ nullptr };
 };
 }
 }
@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+    ChordialThreadPool.cpp
+
+  ==============================================================================
+*/
+
+namespace chordial
+{
+namespace synth
+{
+
+class ChordialThreadPool::Worker : public juce::Thread
+{
+public:
+    Worker(ChordialThreadPool& owner, int participant)
+        : juce::Thread("Chordial render " + juce::String(participant)), pool(owner), index(participant)
+    {
+    }
+
+    void run() override
+    {
+        juce::FloatVectorOperations::disableDenormalisedNumberSupport();
+
+        auto seen = pool.generation.load();
+        auto idle = 0;
+
+        while (!threadShouldExit())
+        {
+            const auto batch = pool.generation.load();
+
+            if (batch != seen)
+            {
+                seen = batch;
+                idle = 0;
+                pool.work(index, batch);
+            }
+            else if (++idle < spinsBeforeSleeping)
+            {
+                juce::Thread::yield();
+            }
+            else
+            {
+                wait(1);
+            }
+        }
+    }
+
+private:
+    ChordialThreadPool& pool;
+    const int index;
+};
+
+ChordialThreadPool::ChordialThreadPool(int numWorkerThreads)
+{
+    jassert(numWorkerThreads >= 0);
+
+    ranges.reset(new Range[static_cast<size_t>(numWorkerThreads + 1)]);
+
+    for (int i = 0; i < numWorkerThreads; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(*this, i + 1));
+        workers.back()->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(10));
+    }
+}
+
+ChordialThreadPool::~ChordialThreadPool()
+{
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+}
+
+void ChordialThreadPool::run(int numTasks, Task task, void* context)
+{
+    if (numTasks <= 0)
+        return;
+
+    const auto batch = generation.load() + 1;
+    const auto numParticipants = getNumThreads();
+
+    // Resetting the claims first invalidates any worker still holding the previous batch
+    for (int p = 0; p < numParticipants; ++p)
+    {
+        const auto start = static_cast<juce::uint32>((numTasks * p) / numParticipants);
+        ranges[p].claim.store((static_cast<juce::uint64>(batch) << 32) | start);
+        ranges[p].end.store((numTasks * (p + 1)) / numParticipants);
+    }
+
+    currentTask.store(task);
+    currentContext.store(context);
+    remaining.store(numTasks);
+    finished.reset();
+    generation.store(batch);
+
+    work(0, batch);
+
+    for (int spin = 0; remaining.load() > 0; ++spin)
+    {
+        // A late signal from the previous batch only costs another check
+        if (spin >= spinsBeforeBlocking)
+            finished.wait();
+    }
+}
+
+void ChordialThreadPool::work(int participant, juce::uint32 batch)
+{
+    const auto task = currentTask.load();
+    const auto context = currentContext.load();
+    const auto numParticipants = getNumThreads();
+
+    // Own range first, then steal from the others in a fixed order
+    for (int i = 0; i < numParticipants; ++i)
+    {
+        auto& range = ranges[(participant + i) % numParticipants];
+        int taskIndex;
+
+        while (claim(range, batch, taskIndex))
+        {
+            task(context, taskIndex);
+
+            if (remaining.fetch_sub(1) == 1)
+                finished.signal();
+        }
+    }
+}
+
+bool ChordialThreadPool::claim(Range& range, juce::uint32 batch, int& taskIndex)
+{
+    auto current = range.claim.load();
+
+    for (;;)
+    {
+        if (static_cast<juce::uint32>(current >> 32) != batch)
+            return false;
+
+        const auto index = static_cast<int>(static_cast<juce::uint32>(current));
+        if (index >= range.end.load())
+            return false;
+
+        if (range.claim.compare_exchange_weak(current, current + 1))
+        {
+            taskIndex = index;
+            return true;
+        }
+    }
+}
+
+}
+}
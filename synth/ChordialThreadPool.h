@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    ChordialThreadPool.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Pre-spawned worker threads for rendering on behalf of the audio thread.
+
+    run() splits a batch of tasks into one contiguous range per participant (the
+    calling thread plus every worker). Each participant drains its own range and then
+    steals from the others, all through atomic claims, so the hot path neither locks
+    nor allocates. Because the caller also steals, a batch completes even if no worker
+    wakes up in time.
+
+    Workers spin (yielding) while batches keep arriving and fall back to polling every
+    millisecond after about spinsBeforeSleeping idle iterations. The caller spins for
+    spinsBeforeBlocking checks on the batch, then blocks until the last task signals, so
+    a descheduled worker does not leave it burning its core.
+*/
+class ChordialThreadPool
+{
+public:
+    using Task = void (*)(void* context, int taskIndex);
+
+    // Not real-time safe
+    explicit ChordialThreadPool(int numWorkerThreads);
+    ~ChordialThreadPool();
+
+    // Workers plus the calling thread
+    int getNumThreads() const noexcept { return static_cast<int>(workers.size()) + 1; }
+
+    // Runs task(context, i) for every i in [0, numTasks) and returns once all have finished.
+    // Only one thread may call this at a time.
+    void run(int numTasks, Task task, void* context);
+
+    static constexpr int spinsBeforeSleeping = 20000;
+    static constexpr int spinsBeforeBlocking = 4000;
+
+private:
+    class Worker;
+
+    struct Range
+    {
+        // Batch generation in the upper 32 bits, next task index in the lower 32
+        std::atomic<juce::uint64> claim{ 0 };
+        std::atomic<int> end{ 0 };
+        char padding[64 - sizeof(std::atomic<juce::uint64>) - sizeof(std::atomic<int>)];
+    };
+
+    void work(int participant, juce::uint32 batch);
+    bool claim(Range& range, juce::uint32 batch, int& taskIndex);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<Range[]> ranges;
+
+    std::atomic<juce::uint32> generation{ 0 };
+    std::atomic<Task> currentTask{ nullptr };
+    std::atomic<void*> currentContext{ nullptr };
+    std::atomic<int> remaining{ 0 };
+    juce::WaitableEvent finished;
+};
+
+}
+}
@@ -0,0 +1,289 @@
+/*
+  ==============================================================================
+
+    ChordialTrace.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+// One span boundary or instant, as recorded on the audio thread. name must be a string
+// literal: only the pointer is stored.
+struct ChordialTraceEvent
+{
+    juce::int64 ticks;
+    const char* name;
+    juce::int32 voice; // -1 for none
+    juce::int32 value; // -1 for none
+    char phase;        // 'B'egin, 'E'nd or 'i'nstant, as in the Chrome trace event format
+};
+
+// One thread's preallocated trace events. Recording costs one relaxed load while tracing
+// is stopped.
+class ChordialTraceLane
+{
+public:
+    void allocate(size_t capacity, const std::atomic<bool>* enabledFlag)
+    {
+        ring.allocate(capacity);
+        enabled = enabledFlag;
+    }
+
+    bool isEnabled() const noexcept { return enabled != nullptr && enabled->load(std::memory_order_relaxed); }
+
+    void record(char phase, const char* name, int voice, int value) noexcept
+    {
+        ring.push({ juce::Time::getHighResolutionTicks(), name, voice, value, phase });
+    }
+
+    void instant(const char* name, int voice, int value) noexcept
+    {
+        if (isEnabled())
+            record('i', name, voice, value);
+    }
+
+    // A span that began while tracing always gets its end, so stopping never leaves one open
+    class ScopedSpan
+    {
+    public:
+        ScopedSpan(ChordialTraceLane* traceLane, const char* spanName, int voice, int value) noexcept
+            : lane(traceLane != nullptr && traceLane->isEnabled() ? traceLane : nullptr), name(spanName)
+        {
+            if (lane != nullptr)
+                lane->record('B', name, voice, value);
+        }
+
+        ~ScopedSpan()
+        {
+            if (lane != nullptr)
+                lane->record('E', name, -1, -1);
+        }
+
+    private:
+        ChordialTraceLane* lane;
+        const char* name;
+    };
+
+    ChordialEventRing<ChordialTraceEvent> ring;
+
+private:
+    const std::atomic<bool>* enabled{ nullptr };
+};
+
+/*  Timeline tracing for ChordialSynthesiser, compiled in with CHORDIAL_TRACE=1.
+
+    Lanes follow ChordialPerfCounters' rings: lane 0 is the audio thread, lane b + 1 voice
+    bucket b. While tracing, a background thread drains the lanes every writeIntervalMs and
+    appends the events to a Chrome trace event JSON file (chrome://tracing, ui.perfetto.dev),
+    one trace thread per lane. A lane that fills between writes drops events; the number
+    dropped is written as a final instant.
+*/
+class ChordialTracer
+{
+public:
+    static constexpr size_t defaultLaneCapacity = 65536;
+    static constexpr int writeIntervalMs = 20;
+
+    ~ChordialTracer() { stop(); }
+
+    static constexpr bool isEnabled() noexcept { return CHORDIAL_TRACE != 0; }
+
+    // Not real-time safe. Allocates nothing when tracing is compiled out.
+    void prepare(int numLanesToAllocate, size_t laneCapacity = defaultLaneCapacity)
+    {
+        const juce::ScopedLock lock(writeLock);
+
+        flush();
+        lanes.reset();
+        numLanes = 0;
+        if (!isEnabled())
+            return;
+
+        numLanes = juce::jmax(1, numLanesToAllocate);
+        lanes.reset(new ChordialTraceLane[static_cast<size_t>(numLanes)]);
+        for (int i = 0; i < numLanes; ++i)
+            lanes[i].allocate(laneCapacity, &enabled);
+    }
+
+    // nullptr when compiled out or unprepared, so the recording macros can test for it
+    ChordialTraceLane* getLane(int index) noexcept
+    {
+        return juce::isPositiveAndBelow(index, numLanes) ? &lanes[index] : nullptr;
+    }
+
+    // Not real-time safe. Replaces file.
+    bool start(const juce::File& file)
+    {
+        stop();
+        if (!isEnabled())
+            return false;
+
+        {
+            const juce::ScopedLock lock(writeLock);
+
+            file.deleteFile();
+            stream = std::make_unique<juce::FileOutputStream>(file);
+            if (!stream->openedOk())
+            {
+                stream = nullptr;
+                return false;
+            }
+
+            // Anything recorded before now belongs to an earlier trace
+            for (int i = 0; i < numLanes; ++i)
+                lanes[i].ring.popAll([](const ChordialTraceEvent&) {});
+
+            startTicks = juce::Time::getHighResolutionTicks();
+            droppedAtStart = getNumDropped();
+            *stream << "[";
+            firstEvent = true;
+            for (int i = 0; i < numLanes; ++i)
+                writeThreadName(i);
+        }
+
+        enabled.store(true);
+        writer = std::make_unique<Writer>(*this);
+        writer->startThread();
+        return true;
+    }
+
+    // Not real-time safe
+    void stop()
+    {
+        if (writer == nullptr)
+            return;
+
+        enabled.store(false);
+        writer->stopThread(-1);
+        writer = nullptr;
+
+        const juce::ScopedLock lock(writeLock);
+        flush();
+
+        const auto dropped = getNumDropped() - droppedAtStart;
+        if (dropped > 0)
+        {
+            writeSeparator();
+            *stream << "{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+                    << juce::String(toMicroseconds(juce::Time::getHighResolutionTicks()), 3)
+                    << ",\"args\":{\"count\":" << static_cast<juce::int64>(dropped) << "}}";
+        }
+
+        *stream << "\n]\n";
+        stream = nullptr;
+    }
+
+    bool isTracing() const noexcept { return enabled.load(); }
+
+private:
+    class Writer : public juce::Thread
+    {
+    public:
+        explicit Writer(ChordialTracer& owner) : juce::Thread("Chordial trace writer"), tracer(owner) {}
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                {
+                    const juce::ScopedLock lock(tracer.writeLock);
+                    tracer.flush();
+                }
+                wait(writeIntervalMs);
+            }
+        }
+
+    private:
+        ChordialTracer& tracer;
+    };
+
+    // Caller holds writeLock
+    void flush()
+    {
+        if (stream == nullptr)
+            return;
+
+        for (int i = 0; i < numLanes; ++i)
+        {
+            lanes[i].ring.popAll([this, i](const ChordialTraceEvent& event)
+            {
+                writeSeparator();
+                *stream << "{\"name\":\"" << event.name << "\",\"ph\":\"" << juce::String::charToString(event.phase)
+                        << "\",\"pid\":1,\"tid\":" << juce::String(i)
+                        << ",\"ts\":" << juce::String(toMicroseconds(event.ticks), 3);
+
+                if (event.phase == 'i')
+                    *stream << ",\"s\":\"t\"";
+
+                if (event.voice >= 0 || event.value >= 0)
+                {
+                    *stream << ",\"args\":{";
+                    if (event.voice >= 0)
+                        *stream << "\"voice\":" << juce::String(event.voice) << (event.value >= 0 ? "," : "");
+                    if (event.value >= 0)
+                        *stream << "\"value\":" << juce::String(event.value);
+                    *stream << "}";
+                }
+
+                *stream << "}";
+            });
+        }
+
+        stream->flush();
+    }
+
+    void writeThreadName(int lane)
+    {
+        writeSeparator();
+        *stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << juce::String(lane)
+                << ",\"args\":{\"name\":\"" << (lane == 0 ? juce::String("audio thread") : "voice bucket " + juce::String(lane - 1)) << "\"}}";
+    }
+
+    void writeSeparator()
+    {
+        *stream << (firstEvent ? "\n" : ",\n");
+        firstEvent = false;
+    }
+
+    double toMicroseconds(juce::int64 ticks) const
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks - startTicks) * 1.0e6;
+    }
+
+    juce::uint64 getNumDropped() const
+    {
+        juce::uint64 dropped = 0;
+        for (int i = 0; i < numLanes; ++i)
+            dropped += lanes[i].ring.getNumDropped();
+        return dropped;
+    }
+
+    std::unique_ptr<ChordialTraceLane[]> lanes;
+    int numLanes{ 0 };
+    std::atomic<bool> enabled{ false };
+
+    juce::CriticalSection writeLock;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    std::unique_ptr<Writer> writer;
+    juce::int64 startTicks{ 0 };
+    juce::uint64 droppedAtStart{ 0 };
+    bool firstEvent{ true };
+};
+
+}
+}
+
+#if CHORDIAL_TRACE
+ #define CHORDIAL_TRACE_SCOPE(lane, name, voice, value) \
+    const chordial::synth::ChordialTraceLane::ScopedSpan JUCE_JOIN_MACRO(chordialTraceSpan, __LINE__)(lane, name, voice, value)
+ #define CHORDIAL_TRACE_INSTANT(lane, name, voice, value) \
+    do { if (auto* chordialTraceLane = (lane)) chordialTraceLane->instant(name, voice, value); } while (false)
+#else
+ #define CHORDIAL_TRACE_SCOPE(lane, name, voice, value)
+ #define CHORDIAL_TRACE_INSTANT(lane, name, voice, value) do {} while (false)
+#endif
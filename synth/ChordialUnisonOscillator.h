@@ -0,0 +1,386 @@
+/*
+  ==============================================================================
+
+    ChordialUnisonOscillator.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  A stack of 1 to 16 copies of one oscillator (a supersaw with the saw waveform), rendered
+    straight into the output block. Copy v of N is detuned and panned by -1 + 2v / (N - 1)
+    times the master's detune and pan spread, so three copies are ChordialVoice's three
+    oscillators. Each copy's gain is sqrt(3 / N), which keeps the stack's power, the copies
+    being uncorrelated, at that of three.
+
+    The copies sit in the lanes of ChordialSIMDRegisters (4 for SSE/NEON floats), as in
+    ChordialOscillatorBank, so a sample of a whole register's copies costs about what one
+    copy does and the cost grows with the number of registers rather than copies. The
+    registers are added lane by lane into a short [sample][lane] mix per channel, whose lanes
+    are summed into the channels once per sub-block rather than with a horizontal sum per
+    sample. Phases are normalised floats, as SIMDRegister has no shifts or int to float
+    conversion for a ChordialPhaseAccumulator.
+*/
+template <typename FloatType>
+class ChordialUnisonOscillator : public ChordialModuleVoice<FloatType>
+{
+public:
+    using Register = ChordialSIMDRegister<FloatType>;
+
+    static constexpr int maxVoices = 16;
+    static constexpr int lanes = static_cast<int>(Register::SIMDNumElements);
+    static_assert(maxVoices % lanes == 0, "Copies are padded to whole registers");
+
+    // Samples rendered into the lane mixes between reductions into the channels
+    static constexpr size_t subBlockSize = 64;
+
+    ChordialUnisonOscillator()
+    {
+        for (auto* buffer : { &phase, &increment, &target, &step, &leftGain, &rightGain })
+            buffer->allocate(maxVoices);
+        for (auto* buffer : { &leftMix, &rightMix })
+            buffer->allocate(subBlockSize * lanes);
+
+        reset();
+        setNumVoices(3);
+    }
+
+    std::shared_ptr<ChordialOscillatorMaster<FloatType>> getMasterOscillator()
+    {
+        return masterOscillator;
+    }
+
+    void setMasterOscillator(std::shared_ptr<ChordialOscillatorMaster<FloatType>> master)
+    {
+        masterOscillator = master;
+    }
+
+    // Real-time safe
+    void setNumVoices(int newNumVoices)
+    {
+        numVoices = juce::jlimit(1, maxVoices, newNumVoices);
+        numRegisters = (numVoices + lanes - 1) / lanes;
+        voiceGain = static_cast<FloatType>(std::sqrt(3.0 / numVoices));
+
+        for (int v = 0; v < maxVoices; ++v)
+        {
+            spread[v] = v < numVoices && numVoices > 1 ? static_cast<FloatType>(-1.0 + 2.0 * v / (numVoices - 1))
+                                                       : static_cast<FloatType>(0.0);
+        }
+
+        updateOscillatorFrequency(true);
+    }
+
+    int getNumVoices() const noexcept { return numVoices; }
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        this->sampleRate = spec.sampleRate;
+        inverseSampleRate = static_cast<FloatType>(1.0 / spec.sampleRate);
+        this->updateDownSampleRate();
+        reset();
+        updateOscillatorFrequency(true);
+    }
+
+    // Scatters the copies' phases, the same way every time so renders repeat. Evenly spaced
+    // phases would cancel the copies' fundamentals.
+    void reset()
+    {
+        juce::Random random(0x5eed);
+        for (int v = 0; v < maxVoices; ++v)
+            phase.get()[v] = static_cast<FloatType>(random.nextDouble());
+    }
+
+    // Heap bytes owned
+    size_t getMemoryUsage() const noexcept
+    {
+        size_t bytes = 0;
+        for (auto* buffer : { &phase, &increment, &target, &step, &leftGain, &rightGain, &leftMix, &rightMix })
+            bytes += buffer->getMemoryUsage();
+        return bytes;
+    }
+
+    void setBaseFrequency(FloatType frequencyInHz)
+    {
+        baseFrequency = frequencyInHz;
+        updateOscillatorFrequency(true);
+    }
+
+    // The mean of the copies' stereo channel gains, for panning a mono sum of them
+    FloatType getMeanChannelGain(int channel) const noexcept
+    {
+        FloatType sum{ 0 };
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const auto pan = masterOscillator->panSpreadAmount * spread[v];
+            sum += channel == 0 ? (pan > 0 ? 1 - pan : 1) : (pan < 0 ? 1 + pan : 1);
+        }
+        return sum / static_cast<FloatType>(numVoices);
+    }
+
+    // Every control processing block, as ChordialOscillatorVoice::updateOscillatorFrequency().
+    // The copies ramp to new frequencies together, like LinearSmoothedValue.
+    void updateOscillatorFrequency(bool force = false)
+    {
+        if (masterOscillator == nullptr)
+            return;
+
+        const auto modulated = baseFrequency * fastmath::octavesToRatio(masterOscillator->frequencyModulationDepth * masterOscillator->frequencyModulation);
+        auto* targets = target.get();
+        auto changed = false;
+
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const auto newTarget = static_cast<FloatType>(modulated * fastmath::octavesToRatio(masterOscillator->detuneAmount * spread[v])) * inverseSampleRate;
+            changed = changed || newTarget != targets[v];
+            targets[v] = newTarget;
+        }
+
+        if (force || stepsToTarget <= 0)
+        {
+            std::copy(targets, targets + maxVoices, increment.get());
+            rampSamplesRemaining = 0;
+        }
+        else if (changed)
+        {
+            for (int v = 0; v < numVoices; ++v)
+                step.get()[v] = (targets[v] - increment.get()[v]) / static_cast<FloatType>(stepsToTarget);
+            rampSamplesRemaining = static_cast<size_t>(stepsToTarget);
+        }
+    }
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context)
+    {
+        updateOscillatorFrequency();
+
+        auto& output = context.getOutputBlock();
+        const auto numSamples = output.getNumSamples();
+        auto* left = output.getChannelPointer(0);
+        auto* right = output.getNumChannels() > 1 ? output.getChannelPointer(1) : nullptr;
+
+        updateGains(right != nullptr);
+
+        const auto rampSamples = juce::jmin(numSamples, rampSamplesRemaining);
+        if (rampSamples > 0)
+        {
+            render<true>(left, right, rampSamples);
+            rampSamplesRemaining -= rampSamples;
+            if (rampSamplesRemaining == 0)
+                std::copy(target.get(), target.get() + maxVoices, increment.get());
+        }
+
+        if (rampSamples < numSamples)
+            render<false>(left + rampSamples, right != nullptr ? right + rampSamples : nullptr, numSamples - rampSamples);
+    }
+
+private:
+    using Waveform = typename ChordialOscillatorMaster<FloatType>::Waveform;
+    using Wavetable = ChordialWavetable<FloatType>;
+
+    // The pan law of ChordialOscillatorVoice::process, with padding lanes silent
+    void updateGains(bool stereo) noexcept
+    {
+        for (int v = 0; v < maxVoices; ++v)
+        {
+            const auto active = v < numVoices;
+            const auto pan = stereo ? masterOscillator->panSpreadAmount * spread[v] : static_cast<FloatType>(0.0);
+            leftGain.get()[v] = active ? voiceGain * (pan > 0 ? 1 - pan : 1) : 0;
+            rightGain.get()[v] = active ? voiceGain * (pan < 0 ? 1 + pan : 1) : 0;
+        }
+    }
+
+    template <bool ramping>
+    void render(FloatType* left, FloatType* right, size_t numSamples)
+    {
+        const auto localAA = masterOscillator->antialiased.load();
+
+        switch (masterOscillator->waveform.load())
+        {
+        case Waveform::saw:
+            if (localAA) renderChannels<Waveform::saw, true, ramping>(left, right, numSamples);
+            else         renderChannels<Waveform::saw, false, ramping>(left, right, numSamples);
+            break;
+        case Waveform::square:
+            if (localAA) renderChannels<Waveform::square, true, ramping>(left, right, numSamples);
+            else         renderChannels<Waveform::square, false, ramping>(left, right, numSamples);
+            break;
+        case Waveform::wavetable:
+            renderChannels<Waveform::wavetable, false, ramping>(left, right, numSamples);
+            break;
+        case Waveform::triangle:
+        default:
+            renderChannels<Waveform::triangle, false, ramping>(left, right, numSamples);
+            break;
+        }
+    }
+
+    template <Waveform waveform, bool antialiased, bool ramping>
+    void renderChannels(FloatType* left, FloatType* right, size_t numSamples)
+    {
+        for (size_t start = 0; start < numSamples; start += subBlockSize)
+        {
+            const auto length = juce::jmin(subBlockSize, numSamples - start);
+
+            for (int index = 0; index < numRegisters; ++index)
+            {
+                const auto offset = static_cast<size_t>(index * lanes);
+                if (right != nullptr) renderRegister<waveform, antialiased, ramping, true>(offset, index == 0, length);
+                else                  renderRegister<waveform, antialiased, ramping, false>(offset, index == 0, length);
+            }
+
+            simd::addLanes(leftMix.get(), left + start, length);
+            if (right != nullptr)
+                simd::addLanes(rightMix.get(), right + start, length);
+        }
+    }
+
+    template <Waveform waveform, bool antialiased, bool ramping, bool stereo>
+    void renderRegister(size_t offset, bool firstRegister, size_t numSamples)
+    {
+        const auto zero = Register::expand(static_cast<FloatType>(0.0));
+        const auto one = Register::expand(static_cast<FloatType>(1.0));
+        const auto half = Register::expand(static_cast<FloatType>(0.5));
+        const auto two = Register::expand(static_cast<FloatType>(2.0));
+
+        auto p = Register::fromRawArray(phase.get() + offset);
+        auto inc = Register::fromRawArray(increment.get() + offset);
+        const auto incrementStep = Register::fromRawArray(step.get() + offset);
+        const auto gainLeft = Register::fromRawArray(leftGain.get() + offset);
+        const auto gainRight = Register::fromRawArray(rightGain.get() + offset);
+
+        // Exact at the block start, then Newton-refined per sample while ramping
+        auto inverseIncrement = zero;
+        if (antialiased)
+        {
+            for (size_t lane = 0; lane < static_cast<size_t>(lanes); ++lane)
+            {
+                const auto laneIncrement = inc.get(lane);
+                inverseIncrement.set(lane, laneIncrement > 0 ? static_cast<FloatType>(1.0) / laneIncrement : static_cast<FloatType>(0.0));
+            }
+        }
+
+        // Registers have no gather, so table reads go lane by lane, all at the level for the
+        // faster end of any ramp
+        const FloatType* tables[lanes][2] = {};
+        FloatType blend{ 0 };
+        if (waveform == Waveform::wavetable)
+        {
+            const auto morph = ChordialOscillatorVoice<FloatType>::getWavetableMorph(*masterOscillator);
+            blend = morph.second;
+            for (size_t lane = 0; lane < static_cast<size_t>(lanes); ++lane)
+            {
+                const auto fastest = juce::jmax(inc.get(lane), target.get()[offset + lane]);
+                const auto level = Wavetable::getLevel(ChordialPhaseAccumulator<>::toIncrement(fastest));
+                tables[lane][0] = wavetable->getTable(morph.first, level);
+                tables[lane][1] = wavetable->getTable(morph.first + 1, level);
+            }
+        }
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            if (ramping)
+                inc += incrementStep;
+
+            Register value;
+
+            if (waveform == Waveform::saw)
+            {
+                value = p * two - one;
+            }
+            else if (waveform == Waveform::square)
+            {
+                value = simd::select(Register::lessThan(p, half), one, zero - one);
+            }
+            else if (waveform == Waveform::triangle)
+            {
+                value = simd::abs(p * two - one) * two - one;
+            }
+            else
+            {
+                for (size_t lane = 0; lane < static_cast<size_t>(lanes); ++lane)
+                {
+                    const auto lanePhase = ChordialPhaseAccumulator<>::toIncrement(p.get(lane));
+                    const auto from = Wavetable::lookup(tables[lane][0], lanePhase);
+                    value.set(lane, from + blend * (Wavetable::lookup(tables[lane][1], lanePhase) - from));
+                }
+            }
+
+            if (antialiased)
+            {
+                if (ramping)
+                    inverseIncrement = simd::refineReciprocal(inc, inverseIncrement);
+
+                if (waveform == Waveform::saw)
+                {
+                    value -= simd::polyBlep(p, inc, inverseIncrement);
+                }
+                else if (waveform == Waveform::square)
+                {
+                    auto shifted = p + half;
+                    shifted -= one & Register::greaterThanOrEqual(shifted, one);
+                    value += simd::polyBlep(p, inc, inverseIncrement);
+                    value -= simd::polyBlep(shifted, inc, inverseIncrement);
+                }
+            }
+
+            auto* leftLanes = leftMix.get() + i * lanes;
+            auto* rightLanes = rightMix.get() + i * lanes;
+
+            if (firstRegister)
+            {
+                (value * gainLeft).copyToRawArray(leftLanes);
+                if (stereo)
+                    (value * gainRight).copyToRawArray(rightLanes);
+            }
+            else
+            {
+                (Register::fromRawArray(leftLanes) + value * gainLeft).copyToRawArray(leftLanes);
+                if (stereo)
+                    (Register::fromRawArray(rightLanes) + value * gainRight).copyToRawArray(rightLanes);
+            }
+
+            p += inc;
+            p -= one & Register::greaterThanOrEqual(p, one);
+        }
+
+        p.copyToRawArray(phase.get() + offset);
+        inc.copyToRawArray(increment.get() + offset);
+    }
+
+    void updateSmoothing(FloatType time) override
+    {
+        stepsToTarget = static_cast<int>(std::floor(time * this->sampleRate));
+    }
+
+    std::shared_ptr<ChordialOscillatorMaster<FloatType>> masterOscillator;
+    const Wavetable* wavetable{ &Wavetable::getShared() };
+
+    int numVoices{ 0 };
+    int numRegisters{ 0 };
+    FloatType voiceGain{ static_cast<FloatType>(1.0) };
+    FloatType baseFrequency{ static_cast<FloatType>(440.0) };
+    FloatType inverseSampleRate{ static_cast<FloatType>(1.0 / 44100.0) };
+    int stepsToTarget{ 0 };
+    size_t rampSamplesRemaining{ 0 };
+
+    // One lane per copy, in cycles per sample for the increments
+    ChordialAlignedBuffer<FloatType> phase;
+    ChordialAlignedBuffer<FloatType> increment;
+    ChordialAlignedBuffer<FloatType> target;
+    ChordialAlignedBuffer<FloatType> step;
+    ChordialAlignedBuffer<FloatType> leftGain;
+    ChordialAlignedBuffer<FloatType> rightGain;
+    // The registers' weighted copies for a sub-block, [sample][lane]
+    ChordialAlignedBuffer<FloatType> leftMix;
+    ChordialAlignedBuffer<FloatType> rightMix;
+    FloatType spread[maxVoices] = {};
+};
+
+}
+}
@@ -34,6 +34,12 @@ ChordialVoice::ChordialVoice(std::shared_ptr<ChordialModMatrixCore> matrixCore,
     o3.setDetuneMultiplier(0.0f);
     o3.setPanoramicSpreadMultiplier(0.0f);
 
+    processorChain.template get<unison>().setMasterOscillator(masterOscillator);
+    updateOscillatorBypass();
+
+    // renderNextBlock() runs the DCA as its output stage, see addToOutput()
+    processorChain.template setBypassed<dca>(true);
+
     auto& f = processorChain.template get<filter>();
     f.setMasterFilter(masterFilter);
 
@@ -41,22 +47,71 @@ ChordialVoice::ChordialVoice(std::shared_ptr<ChordialModMatrixCore> matrixCore,
 
     modMatrix.addModSource({ VOICE_ADSR1_OUT, adsr1.getOutputPtr() });
     modMatrix.addModSource({ VOICE_ADSR2_OUT, adsr2.getOutputPtr() });
+    modMatrix.addAudioRateSource(VOICE_ADSR1_OUT, &adsr1Buffer);
+    modMatrix.addAudioRateSource(VOICE_ADSR2_OUT, &adsr2Buffer);
     modMatrix.addModDestination({ VOICE_FILTER_MASTER_CUTOFF_IN, f.getCutoffModVoicePtr() });
     modMatrix.addModDestination({ VOICE_DCA_GAIN_IN, processorChain.template get<dca>().getGainModInputPtr() });
+    modMatrix.addAudioRateDestination(VOICE_DCA_GAIN_IN, processorChain.template get<dca>().getGainModInputBuffer());
     
 }
 
-void ChordialVoice::prepare(const juce::dsp::ProcessSpec & spec)
+void ChordialVoice::prepare(const juce::dsp::ProcessSpec & hostSpec)
 {
-    tempBlock = juce::dsp::AudioBlock<float>(heapBlock, spec.numChannels, spec.maximumBlockSize);
+    const auto spec = getModuleSpec(hostSpec, signalPath);
+
+    if (scratchArena != nullptr)
+    {
+        jassert(scratchArena->getSize() >= getScratchSize(hostSpec, signalPath, stageBatched));
+        heapBlock.free();
+        if (stageBatched)
+            scratchChannels.free();
+        else
+            scratchChannels.allocate(spec.numChannels, true);
+        layOutScratch(this, spec, !stageBatched);
+    }
+    else
+    {
+        for (auto* module : { &processorChain.template get<osc1>(), &processorChain.template get<osc2>(), &processorChain.template get<osc3>() })
+            module->setScratch(nullptr);
+        processorChain.template get<filter>().setScratch(nullptr);
+        scratchChannels.free();
+    }
+
+    // A stage-batched mix is held between stages, so it stays out of the arena, and only
+    // ever holds one control sub-block
+    if (scratchArena == nullptr)
+        tempBlock = juce::dsp::AudioBlock<float>(heapBlock, spec.numChannels, spec.maximumBlockSize);
+    if (stageBatched)
+        tempBlock = juce::dsp::AudioBlock<float>(heapBlock, spec.numChannels, juce::jmin(static_cast<size_t>(spec.maximumBlockSize), controlRate));
+
     processorChain.prepare(spec);
+    modMatrix.prepare(spec.maximumBlockSize, static_cast<int>(controlRate));
+    adsr1Buffer.allocate(spec.maximumBlockSize);
+    adsr2Buffer.allocate(spec.maximumBlockSize);
+    adsr1Buffer.active = audioRateEnvelopes;
+    adsr2Buffer.active = audioRateEnvelopes;
 
+    controlPeriod = controlRate;
+    controlUpdateCounter = controlRate;
+
+    // The DCA follows the envelopes, so its ramps follow their fastest ticks. The oscillators'
+    // modulation comes from the global matrix, which always ticks at controlRate.
     auto& o1 = processorChain.template get<osc1>();
     auto& o2 = processorChain.template get<osc2>();
+    auto& o3 = processorChain.template get<osc3>();
     auto& d = processorChain.template get<dca>();
-    d.setSamplesPerControlSignal(controlRate);
-    o1.setSamplesPerControlSignal(controlRate);
-    o2.setSamplesPerControlSignal(controlRate);
+    d.setSamplesPerControlSignal(static_cast<int>(adaptiveControlRate ? juce::jmax(static_cast<size_t>(1), controlRate / adaptiveSpeedUp) : controlRate));
+    o1.setSamplesPerControlSignal(static_cast<int>(controlRate));
+    o2.setSamplesPerControlSignal(static_cast<int>(controlRate));
+    o3.setSamplesPerControlSignal(static_cast<int>(controlRate));
+    processorChain.template get<unison>().setSamplesPerControlSignal(static_cast<int>(controlRate));
+}
+
+void ChordialVoice::setControlRate(size_t samplesPerControlSignal, bool adaptive)
+{
+    jassert(samplesPerControlSignal > 0);
+    controlRate = juce::jmax(static_cast<size_t>(1), samplesPerControlSignal);
+    adaptiveControlRate = adaptive;
 }
 
 bool ChordialVoice::canPlaySound(juce::SynthesiserSound *)
@@ -66,7 +121,7 @@ bool ChordialVoice::canPlaySound(juce::SynthesiserSound *)
 
 void ChordialVoice::startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound * sound, int currentPitchWheelPosition)
 {
-    auto hz = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+    auto hz = fastmath::getMidiNoteInHertz(midiNoteNumber);
 
     auto& o1 = processorChain.template get<osc1>();
     o1.setBaseFrequency(hz);
@@ -77,6 +132,15 @@ void ChordialVoice::startNote(int midiNoteNumber, float velocity, juce::Synthesi
     auto& o3 = processorChain.template get<osc3>();
     o3.setBaseFrequency(hz);
 
+    processorChain.template get<unison>().setBaseFrequency(static_cast<float>(hz));
+
+    if (usesOscillatorBank())
+    {
+        oscillatorBank->setFrequency(oscillatorBankSlot, o1.getTargetFrequency(), true);
+        oscillatorBank->setFrequency(oscillatorBankSlot + 1, o2.getTargetFrequency(), true);
+        oscillatorBank->setFrequency(oscillatorBankSlot + 2, o3.getTargetFrequency(), true);
+    }
+
     auto& f = processorChain.template get<filter>();
     f.setNoteNumber(midiNoteNumber);
     f.reset();
@@ -86,10 +150,17 @@ void ChordialVoice::startNote(int midiNoteNumber, float velocity, juce::Synthesi
     adsr1.gate(true);
     adsr2.gate(true);
 
+    CHORDIAL_PERF_EVENT(perfRing, voiceStart, 1);
+    CHORDIAL_TRACE_INSTANT(traceLane, "startNote", traceVoiceIndex, midiNoteNumber);
+
+    if (voiceManager != nullptr)
+        voiceManager->started(managerNode);
+
 }
 
 void ChordialVoice::stopNote(float velocity, bool allowTailOff)
 {
+    CHORDIAL_TRACE_INSTANT(traceLane, "stopNote", traceVoiceIndex, getCurrentlyPlayingNote());
     adsr1.gate(false);
     adsr2.gate(false);
     if (!allowTailOff)
@@ -98,6 +169,9 @@ void ChordialVoice::stopNote(float velocity, bool allowTailOff)
         adsr2.reset();
         clearCurrentNote();
     }
+
+    if (voiceManager != nullptr)
+        voiceManager->update(managerNode);
 }
 
 void ChordialVoice::pitchWheelMoved(int newPitchWheelValue)
@@ -112,34 +186,340 @@ void ChordialVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int
 {
     if (adsr1.isActive() || adsr2.isActive())
     {
-        auto subBlock = tempBlock.getSubBlock((size_t)startSample, (size_t)numSamples);
-        subBlock.clear();
+        CHORDIAL_TRACE_SCOPE(traceLane, "voice", traceVoiceIndex, numSamples);
+        beginBlock(outputBuffer, startSample, numSamples);
+
+        while (beginSegment())
+        {
+            processOscillatorStage();
+            processFilterStage();
+            processOutputStage();
+        }
+    }
+}
+
+void ChordialVoice::beginBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    renderingBlock = adsr1.isActive() || adsr2.isActive();
+    if (!renderingBlock)
+        return;
+
+    blockOutput = juce::dsp::AudioBlock<float>(outputBuffer).getSubBlock((size_t)startSample, (size_t)numSamples);
+    blockPosition = 0;
+    tailPeak = 0.0f;
+    tailMeasured = true;
+}
+
+bool ChordialVoice::beginSegment()
+{
+    if (!renderingBlock)
+        return false;
+
+    if (blockPosition == blockOutput.getNumSamples())
+    {
+        renderingBlock = false;
+
+        if (isVoiceActive() && isInaudibleTail(blockOutput.getNumSamples()))
+        {
+            adsr1.reset();
+            adsr2.reset();
+            quietSamples = 0;
+            clearCurrentNote();
+            retiredNotes.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    const auto max = juce::jmin(blockOutput.getNumSamples() - blockPosition, controlUpdateCounter, tempBlock.getNumSamples());
+    segmentStart = blockPosition;
+    segmentLength = max;
+    tempBlock.getSubBlock(0, max).clear();
 
+    // The control tick below then sees the envelopes' values at the end of this sub-block
+    if (audioRateEnvelopes)
+    {
+        adsr1.processBlock(adsr1Buffer.data.get(), max);
+        adsr2.processBlock(adsr2Buffer.data.get(), max);
+    }
 
-        for (size_t pos = 0; pos < numSamples;)
+    blockPosition += max;
+    controlUpdateCounter -= max;
+    if (controlUpdateCounter == 0)
+    {
+        if (adaptiveControlRate)
         {
-            auto max = juce::jmin(static_cast<size_t> (numSamples - pos), controlUpdateCounter);
-            auto block = subBlock.getSubBlock(pos, max);
-            juce::dsp::ProcessContextReplacing<float> context(block);
-            
-            pos += max;
-            controlUpdateCounter -= max;
-            if (controlUpdateCounter == 0)
+            // Ticks aren't evenly spaced, so step the envelopes by the samples elapsed
+            if (!audioRateEnvelopes)
             {
-                controlUpdateCounter = controlRate;
-                adsr1.getNextValue();
-                adsr2.getNextValue();
-                modMatrix.process();
-                if (!adsr1.isActive() && !adsr2.isActive())
-                    clearCurrentNote();
+                adsr1.advance(controlPeriod);
+                adsr2.advance(controlPeriod);
             }
-            processorChain.process(context);
+            controlPeriod = chooseControlPeriod();
+            modMatrix.setSamplesPerControlSignal(static_cast<int>(controlPeriod));
+        }
+        else if (!audioRateEnvelopes)
+        {
+            adsr1.getNextValue();
+            adsr2.getNextValue();
+        }
+        controlUpdateCounter = controlPeriod;
+        {
+            CHORDIAL_TRACE_SCOPE(traceLane, "voiceModMatrix", traceVoiceIndex, -1);
+            modMatrix.process();
         }
+        if (!adsr1.isActive() && !adsr2.isActive())
+            clearCurrentNote();
+    }
+
+    if (usesOscillatorBank())
+    {
+        auto block = tempBlock.getSubBlock(0, segmentLength);
+        oscillatorBank->addSlotToBlock(oscillatorBankSlot, segmentStart, block, processorChain.template get<osc1>().getPanValue());
+        oscillatorBank->addSlotToBlock(oscillatorBankSlot + 1, segmentStart, block, processorChain.template get<osc2>().getPanValue());
+        oscillatorBank->addSlotToBlock(oscillatorBankSlot + 2, segmentStart, block, processorChain.template get<osc3>().getPanValue());
+    }
+    modMatrix.processAudioRate(max);
+    return true;
+}
+
+void ChordialVoice::processOscillatorStage()
+{
+    CHORDIAL_PERF_SCOPE(perfRing, voiceOscillators);
+    auto block = tempBlock.getSubBlock(0, segmentLength);
+    juce::dsp::ProcessContextReplacing<float> context(block);
+
+    if (!processorChain.template isBypassed<osc1>())
+        processorChain.template get<osc1>().process(context);
+    if (!processorChain.template isBypassed<osc2>())
+        processorChain.template get<osc2>().process(context);
+    if (!processorChain.template isBypassed<osc3>())
+        processorChain.template get<osc3>().process(context);
+    if (!processorChain.template isBypassed<unison>())
+        processorChain.template get<unison>().process(context);
+}
+
+void ChordialVoice::processFilterStage()
+{
+    CHORDIAL_PERF_SCOPE(perfRing, voiceFilter);
+    auto block = tempBlock.getSubBlock(0, segmentLength);
+    processorChain.template get<filter>().process(juce::dsp::ProcessContextReplacing<float>(block));
+}
+
+void ChordialVoice::processFilterStage(ChordialFilterBank<float>& bank)
+{
+    CHORDIAL_PERF_SCOPE(perfRing, voiceFilter);
+    auto block = tempBlock.getSubBlock(0, segmentLength);
+    processorChain.template get<filter>().process(juce::dsp::ProcessContextReplacing<float>(block), bank);
+}
+
+void ChordialVoice::processOutputStage()
+{
+    const auto mix = tempBlock.getSubBlock(0, segmentLength);
+    const auto peakGain = addToOutput(mix, blockOutput.getSubBlock(segmentStart, segmentLength));
+    measureTail(mix, peakGain);
+}
+
+void ChordialVoice::setTraceLane(ChordialTraceLane* lane, int voiceIndex)
+{
+    traceLane = lane;
+    traceVoiceIndex = voiceIndex;
+    processorChain.template get<filter>().setTraceLane(lane, voiceIndex);
+}
+
+float ChordialVoice::addToOutput(const juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<float>& output)
+{
+    CHORDIAL_PERF_SCOPE(perfRing, voiceDCA);
+    auto& d = processorChain.template get<dca>();
+
+    if (signalPath == SignalPath::stereo)
+    {
+        d.processAndAdd(block, output);
+        return d.getPeakGain();
+    }
+
+    // Mono pans as it adds, with the gains the stereo path gives each oscillator, averaged
+    float gains[2] = {};
+    if (unisonVoices > 0)
+    {
+        gains[0] = processorChain.template get<unison>().getMeanChannelGain(0);
+        gains[1] = processorChain.template get<unison>().getMeanChannelGain(1);
+    }
+    else for (auto pan : { processorChain.template get<osc1>().getPanValue(),
+                      processorChain.template get<osc2>().getPanValue(),
+                      processorChain.template get<osc3>().getPanValue() })
+    {
+        gains[0] += (pan > 0 ? 1.0f - pan : 1.0f) / 3.0f;
+        gains[1] += (pan < 0 ? 1.0f + pan : 1.0f) / 3.0f;
+    }
+
+    d.processAndAdd(block, output, gains);
+    return d.getPeakGain() * juce::jmax(gains[0], gains[1]);
+}
+
+juce::dsp::ProcessSpec ChordialVoice::getModuleSpec(const juce::dsp::ProcessSpec& spec, SignalPath path)
+{
+    return { spec.sampleRate, spec.maximumBlockSize, path == SignalPath::mono ? 1u : spec.numChannels };
+}
+
+size_t ChordialVoice::getScratchSize(const juce::dsp::ProcessSpec& hostSpec, SignalPath path, bool stageBatched)
+{
+    return layOutScratch(nullptr, getModuleSpec(hostSpec, path), !stageBatched);
+}
+
+size_t ChordialVoice::getUnsharedScratchSize(const juce::dsp::ProcessSpec& hostSpec, SignalPath path, bool stageBatched)
+{
+    const auto spec = getModuleSpec(hostSpec, path);
+    ChordialScratchArena::Carver carver;
+    if (!stageBatched)
+        carver.take<float>(spec.numChannels * spec.maximumBlockSize);
+    return carver.getNumBytesUsed()
+        + 3 * ChordialOscillatorVoice<float>::getScratchSize(spec)
+        + ChordialFilterVoice<float>::getScratchSize(spec);
+}
+
+size_t ChordialVoice::layOutScratch(ChordialVoice* voice, const juce::dsp::ProcessSpec& spec, bool includeMix)
+{
+    ChordialScratchArena::Carver carver(voice != nullptr ? voice->scratchArena->get() : nullptr);
+
+    for (size_t channel = 0; includeMix && channel < spec.numChannels; ++channel)
+    {
+        auto* region = carver.take<float>(spec.maximumBlockSize);
+        if (voice != nullptr)
+            voice->scratchChannels[channel] = region;
+    }
+
+    auto* stageRegion = carver.take<char>(juce::jmax(ChordialOscillatorVoice<float>::getScratchSize(spec),
+                                                     ChordialFilterVoice<float>::getScratchSize(spec)));
+
+    if (voice != nullptr)
+    {
+        auto& chain = voice->processorChain;
+        if (includeMix)
+            voice->tempBlock = juce::dsp::AudioBlock<float>(voice->scratchChannels.get(), spec.numChannels, spec.maximumBlockSize);
+        for (auto* module : { &chain.template get<osc1>(), &chain.template get<osc2>(), &chain.template get<osc3>() })
+            module->setScratch(stageRegion);
+        chain.template get<filter>().setScratch(stageRegion);
+    }
+
+    return carver.getNumBytesUsed();
+}
+
+size_t ChordialVoice::getMemoryUsage() const
+{
+    auto& chain = processorChain;
+    size_t bytes = sizeof(*this)
+        + chain.template get<osc1>().getMemoryUsage()
+        + chain.template get<osc2>().getMemoryUsage()
+        + chain.template get<osc3>().getMemoryUsage()
+        + chain.template get<unison>().getMemoryUsage()
+        + chain.template get<filter>().getMemoryUsage()
+        + chain.template get<dca>().getMemoryUsage()
+        + modMatrix.getMemoryUsage()
+        + adsr1Buffer.getMemoryUsage()
+        + adsr2Buffer.getMemoryUsage()
+        + (scratchChannels.get() != nullptr ? tempBlock.getNumChannels() * sizeof(float*) : 0);
+
+    if (heapBlock.get() != nullptr)
+        bytes += tempBlock.getNumChannels() * tempBlock.getNumSamples() * sizeof(float);
+
+    return bytes;
+}
+
+size_t ChordialVoice::chooseControlPeriod()
+{
+    const auto elapsed = static_cast<float>(controlPeriod);
+    const float outputs[] = { adsr1.getOutput(), adsr2.getOutput() };
 
-        juce::dsp::AudioBlock<float>(outputBuffer)
-            .getSubBlock((size_t)startSample, (size_t)numSamples)
-            .add(subBlock);
+    auto fast = adsr1.isInAttackOrDecay() || adsr2.isInAttackOrDecay();
+    for (size_t i = 0; i < 2; ++i)
+    {
+        // Change per sample, scaled to a full control period
+        const auto change = std::abs(outputs[i] - previousEnvelopeOutputs[i]) / elapsed * static_cast<float>(controlRate);
+        fast = fast || change > fastChangePerPeriod;
+        previousEnvelopeOutputs[i] = outputs[i];
+    }
+
+    return fast ? juce::jmax(static_cast<size_t>(1), controlRate / adaptiveSpeedUp) : controlRate;
+}
+
+bool ChordialVoice::isHeld()
+{
+    return (adsr1.isActive() && !adsr1.isReleasing()) || (adsr2.isActive() && !adsr2.isReleasing());
+}
+
+void ChordialVoice::measureTail(const juce::dsp::AudioBlock<float>& mix, float peakGain)
+{
+    if (retirementThreshold.load() <= 0.0f || !tailMeasured)
+        return;
+
+    // Never cut a held note, however quiet, so its sub-blocks aren't worth measuring
+    if (isHeld())
+    {
+        tailMeasured = false;
+        return;
+    }
+
+    for (size_t channel = 0; channel < mix.getNumChannels(); ++channel)
+    {
+        float low, high;
+        juce::FloatVectorOperations::findMinAndMax(mix.getChannelPointer(channel), static_cast<int>(mix.getNumSamples()), low, high);
+        tailPeak = juce::jmax(tailPeak, juce::jmax(-low, high) * peakGain);
+    }
+}
+
+bool ChordialVoice::isInaudibleTail(size_t numSamples)
+{
+    const auto threshold = retirementThreshold.load();
+    if (threshold <= 0.0f)
+        return false;
+
+    if (isHeld() || !tailMeasured || tailPeak >= threshold)
+    {
+        quietSamples = 0;
+        return false;
     }
+
+    // A short block can sit on a zero crossing of a low note, so wait for a full cycle at 50 Hz
+    quietSamples += numSamples;
+    return quietSamples >= static_cast<size_t>(getSampleRate() * minimumQuietSeconds);
+}
+
+void ChordialVoice::setOscillatorBank(std::shared_ptr<ChordialOscillatorBank<float>> bank, int firstSlot)
+{
+    oscillatorBank = bank;
+    oscillatorBankSlot = firstSlot;
+
+    updateOscillatorBypass();
+}
+
+void ChordialVoice::setUnisonVoices(int numVoices)
+{
+    unisonVoices = juce::jlimit(0, ChordialUnisonOscillator<float>::maxVoices, numVoices);
+    if (unisonVoices > 0)
+        processorChain.template get<unison>().setNumVoices(unisonVoices);
+
+    updateOscillatorBypass();
+}
+
+void ChordialVoice::updateOscillatorBypass()
+{
+    // The unison stack takes precedence over the bank, which takes it over the chain's oscillators
+    const auto useUnison = unisonVoices > 0;
+    const auto useOscillators = !useUnison && oscillatorBank == nullptr;
+    processorChain.template setBypassed<osc1>(!useOscillators);
+    processorChain.template setBypassed<osc2>(!useOscillators);
+    processorChain.template setBypassed<osc3>(!useOscillators);
+    processorChain.template setBypassed<unison>(!useUnison);
+}
+
+void ChordialVoice::updateOscillatorBank()
+{
+    if (!usesOscillatorBank() || !(adsr1.isActive() || adsr2.isActive()))
+        return;
+
+    oscillatorBank->setFrequency(oscillatorBankSlot, processorChain.template get<osc1>().getTargetFrequency());
+    oscillatorBank->setFrequency(oscillatorBankSlot + 1, processorChain.template get<osc2>().getTargetFrequency());
+    oscillatorBank->setFrequency(oscillatorBankSlot + 2, processorChain.template get<osc3>().getTargetFrequency());
 }
 }
 }
@@ -38,29 +38,169 @@ public:
     void pitchWheelMoved(int newPitchWheelValue) override;
     void controllerMoved(int controllerNumber, int newControllerValue) override;
     void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override;
+
+    // Renders the oscillators through a shared bank instead of the per-voice chain slots.
+    // Pass nullptr to return to the per-voice oscillators.
+    void setOscillatorBank(std::shared_ptr<ChordialOscillatorBank<float>> bank, int firstSlot);
+    // Pushes this voice's oscillator frequencies to the bank, call before each bank process()
+    void updateOscillatorBank();
+
+    // 1 to 16 renders a ChordialUnisonOscillator stack of that many copies in place of the
+    // three oscillators and any bank; 0, the default, goes back to them. Audio thread or
+    // before playback.
+    void setUnisonVoices(int numVoices);
+
+    // Ends a released note once its output has stayed below this gain for 20 ms, instead
+    // of waiting for the envelopes to reach zero. 0 disables. Real-time safe.
+    void setRetirementThreshold(float gain) { retirementThreshold.store(gain); }
+    juce::uint32 getNumRetiredNotes() const { return retiredNotes.load(); }
+
+    // Renders both envelopes sample by sample into audio rate modulation sources, instead of
+    // stepping them once per control period. Not real-time safe, call before prepare.
+    void setAudioRateEnvelopes(bool shouldUseAudioRate) { audioRateEnvelopes = shouldUseAudioRate; }
+
+    // Samples between control ticks. Adaptive ticks adaptiveSpeedUp times as often while an
+    // envelope is in attack or decay or still moving quickly, and at samplesPerControlSignal
+    // otherwise. Not real-time safe, call before prepare.
+    void setControlRate(size_t samplesPerControlSignal, bool adaptive);
+
+    // Where this voice records stage timings and starts when built with CHORDIAL_PERF_COUNTERS.
+    // Set by the synthesiser in prepareToPlay.
+    void setPerfRing(ChordialPerfRing* ring) noexcept { perfRing = ring; }
+    // Where this voice records its spans and note events when built with CHORDIAL_TRACE,
+    // tagged with voiceIndex. Set by the synthesiser in prepareToPlay.
+    void setTraceLane(ChordialTraceLane* lane, int voiceIndex);
+
+    // Stereo runs the oscillators, filter and DCA on both channels. Mono sums the oscillators
+    // into one channel, filters and amplifies that and pans it last by the oscillators' mean
+    // channel gains, for about half the filter cost; the pan spread then moves the whole voice
+    // rather than each oscillator, and nothing reaches the filter in stereo.
+    enum class SignalPath
+    {
+        stereo,
+        mono
+    };
+    // Not real-time safe, call before prepare
+    void setSignalPath(SignalPath path) { signalPath = path; }
+
+    // Render scratch prepare() takes from a shared arena: the voice's mix block, unless
+    // stage-batched, plus one region the oscillators and then the filter work in, as they
+    // never run at once
+    static size_t getScratchSize(const juce::dsp::ProcessSpec& spec, SignalPath path = SignalPath::stereo, bool stageBatched = false);
+    // The same buffers when the voice and each of its modules allocate their own
+    static size_t getUnsharedScratchSize(const juce::dsp::ProcessSpec& spec, SignalPath path = SignalPath::stereo, bool stageBatched = false);
+    // Renders through arena, of at least getScratchSize() bytes and shared with the voices
+    // rendering one after another on the same thread, instead of allocating. Not real-time
+    // safe, call before prepare; nullptr goes back to allocating.
+    void setScratchArena(ChordialScratchArena* arena) noexcept { scratchArena = arena; }
+    // Keeps the mix block out of the arena, on the heap, as stage-batched rendering holds
+    // every voice's mix between stages. Not real-time safe, call before prepare.
+    void setStageBatched(bool shouldBatch) noexcept { stageBatched = shouldBatch; }
+
+    // renderNextBlock() in pieces, so a caller can run each stage across many voices before
+    // the next (see ChordialSynthesiser::VoiceScheduling). beginBlock(), then while
+    // beginSegment() returns true, the three stages in order, each on one control sub-block;
+    // the beginSegment() returning false finishes the block. Audio thread.
+    void beginBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
+    bool beginSegment();
+    void processOscillatorStage();
+    void processFilterStage();
+    // The filter stage with the chordialLadder engine's work queued on bank, with other
+    // voices', instead; the stage is done once bank.process() returns
+    void processFilterStage(ChordialFilterBank<float>& bank);
+    void processOutputStage();
+    // Between a beginSegment() returning true and the one returning false
+    bool isRenderingBlock() const noexcept { return renderingBlock; }
+    // Heap bytes owned by this voice, the voice itself included and shared scratch excluded
+    size_t getMemoryUsage() const;
+
+    // The manager's node for this voice. Once set, startNote() and stopNote() keep the
+    // manager's lists up to date; the synthesiser handles everything else.
+    ChordialVoiceManager::Node& getManagerNode() noexcept { return managerNode; }
+    void setVoiceManager(ChordialVoiceManager* manager) noexcept { voiceManager = manager; }
     
 private:
+    bool isHeld();
+    // Adds a sub-block's peak to the block's, mix being the voice before the DCA and peakGain
+    // the most the DCA applied to it
+    void measureTail(const juce::dsp::AudioBlock<float>& mix, float peakGain);
+    // Whether the block just rendered, of numSamples, ends a long enough quiet release
+    bool isInaudibleTail(size_t numSamples);
+    size_t chooseControlPeriod();
+    // Measures the arena scratch with voice == nullptr, else hands it out to voice, the mix
+    // block only if includeMix. spec is the modules' spec, see getModuleSpec().
+    static size_t layOutScratch(ChordialVoice* voice, const juce::dsp::ProcessSpec& spec, bool includeMix);
+    static juce::dsp::ProcessSpec getModuleSpec(const juce::dsp::ProcessSpec& spec, SignalPath path);
+    // The DCA, plus the mono path's pan, fused with adding to the output. Returns the DCA's
+    // peak gain times the larger pan gain.
+    float addToOutput(const juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<float>& output);
+    bool usesOscillatorBank() const noexcept { return oscillatorBank != nullptr && unisonVoices == 0; }
+    void updateOscillatorBypass();
+
     enum {
         osc1 = 0,
         osc2,
         osc3,
+        unison,
         filter,
         dca
     };
 
     juce::HeapBlock<char> heapBlock;
+    ChordialScratchArena* scratchArena{ nullptr };
+    juce::HeapBlock<float*> scratchChannels;
     juce::dsp::AudioBlock<float> tempBlock;
+    bool stageBatched{ false };
+
+    // The block and control sub-block being rendered, see beginBlock(). The mix, tempBlock,
+    // holds one sub-block at a time.
+    bool renderingBlock{ false };
+    juce::dsp::AudioBlock<float> blockOutput;
+    size_t blockPosition{ 0 };
+    size_t segmentStart{ 0 };
+    size_t segmentLength{ 0 };
+    float tailPeak{ 0.0f };
+    bool tailMeasured{ true };
 
     juce::dsp::ProcessorChain<ChordialOscillatorVoice<float>, ChordialOscillatorVoice<float>, ChordialOscillatorVoice<float>, 
+        ChordialUnisonOscillator<float>,
         ChordialFilterVoice<float>,
         ChordialDCAVoice<float>> processorChain;
 
-    static constexpr size_t controlRate = 100;
-    size_t controlUpdateCounter = controlRate;
+    static constexpr size_t defaultControlRate = 100;
+    static constexpr size_t adaptiveSpeedUp = 4;
+    // An envelope moving more than this over a full control period counts as fast
+    static constexpr float fastChangePerPeriod = 0.01f;
+
+    size_t controlRate = defaultControlRate;
+    size_t controlUpdateCounter = defaultControlRate;
+    size_t controlPeriod = defaultControlRate;
+    bool adaptiveControlRate{ false };
+    float previousEnvelopeOutputs[2] = {};
 
     ChordialVoiceADSR<float, float> adsr1;
     ChordialVoiceADSR<float, float> adsr2;
     ChordialModMatrix<float> modMatrix;
+    bool audioRateEnvelopes{ false };
+    SignalPath signalPath{ SignalPath::stereo };
+    ChordialModulationBuffer<float> adsr1Buffer;
+    ChordialModulationBuffer<float> adsr2Buffer;
+
+    std::shared_ptr<ChordialOscillatorBank<float>> oscillatorBank;
+    int oscillatorBankSlot{ 0 };
+    int unisonVoices{ 0 };
+
+    static constexpr double minimumQuietSeconds = 0.02;
+    std::atomic<float> retirementThreshold{ 0.00001f }; // -100 dB
+    std::atomic<juce::uint32> retiredNotes{ 0 };
+    size_t quietSamples{ 0 };
+
+    ChordialPerfRing* perfRing{ nullptr };
+    ChordialTraceLane* traceLane{ nullptr };
+    int traceVoiceIndex{ -1 };
+
+    ChordialVoiceManager::Node managerNode{ *this };
+    ChordialVoiceManager* voiceManager{ nullptr };
 };
 
 }
@@ -0,0 +1,268 @@
+/*
+  ==============================================================================
+
+    ChordialVoiceManager.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Keeps a synthesiser's voices in intrusive lists by state, each in start order, plus one
+    list per MIDI note of every voice sounding it, so allocation and stealing read a list
+    head instead of sorting the voices.
+
+    States follow juce::SynthesiserVoice's flags: held has the key down, sustained is key up
+    but held by a pedal, released is isPlayingButReleased(). Starting a voice appends it;
+    moving it between the active states inserts it by start order, walking back from the
+    newest, which is a step or two since notes mostly end in the order they began.
+
+    Audio thread only, apart from add() and remove().
+*/
+class ChordialVoiceManager
+{
+public:
+    enum class State
+    {
+        free,
+        held,
+        sustained,
+        released,
+        numStates
+    };
+
+    // Embedded in each voice
+    struct Node
+    {
+        explicit Node(juce::SynthesiserVoice& owner) : voice(owner) {}
+
+        juce::SynthesiserVoice& voice;
+        Node* previous{ nullptr };
+        Node* next{ nullptr };
+        Node* previousOnNote{ nullptr };
+        Node* nextOnNote{ nullptr };
+        State state{ State::free };
+        int note{ -1 };
+        juce::uint32 startOrder{ 0 };
+        bool managed{ false };
+    };
+
+    // Not real-time safe
+    void add(Node& node)
+    {
+        jassert(!node.managed);
+        node.managed = true;
+        node.state = State::free;
+        node.note = -1;
+        append(getList(State::free), node);
+        update(node);
+    }
+
+    // Not real-time safe. Call before the voice is deleted.
+    void remove(Node& node)
+    {
+        if (!node.managed)
+            return;
+
+        unlinkNote(node);
+        unlink(getList(node.state), node);
+        node.managed = false;
+    }
+
+    // Call from the voice's startNote(). A voice restarted on the note it was already
+    // playing keeps its state and note, so update() alone would leave it at its old place;
+    // like noteOnTime, the start always makes it the newest.
+    void started(Node& node) noexcept
+    {
+        if (!node.managed)
+            return;
+
+        unlink(getList(node.state), node);
+        unlinkNote(node);
+        node.state = State::free;
+        append(getList(State::free), node);
+        update(node);
+    }
+
+    // Reclassifies a voice from its flags, after anything that may have changed them
+    void update(Node& node) noexcept
+    {
+        if (!node.managed)
+            return;
+
+        const auto state = classify(node.voice);
+        const auto note = node.voice.getCurrentlyPlayingNote();
+
+        if (state == node.state && (state == State::free || note == node.note))
+            return;
+
+        unlink(getList(node.state), node);
+
+        if (state == State::free)
+        {
+            unlinkNote(node);
+            append(getList(State::free), node);
+        }
+        else if (node.state == State::free || note != node.note)
+        {
+            // A new note is the newest voice in every list it joins
+            unlinkNote(node);
+            node.startOrder = ++startCounter;
+            node.note = note;
+            append(getList(state), node);
+            if (juce::isPositiveAndBelow(note, numNotes))
+                append(notes[note], node, &Node::previousOnNote, &Node::nextOnNote);
+        }
+        else
+        {
+            insertInStartOrder(getList(state), node);
+        }
+
+        node.state = state;
+    }
+
+    // Reclassifies every voice sounding midiNoteNumber
+    void updateNote(int midiNoteNumber) noexcept
+    {
+        if (!juce::isPositiveAndBelow(midiNoteNumber, numNotes))
+            return;
+
+        for (auto* node = notes[midiNoteNumber].first; node != nullptr;)
+        {
+            auto* next = node->nextOnNote;
+            update(*node);
+            node = next;
+        }
+    }
+
+    // Reclassifies every active voice, e.g. after a pedal change or voices finishing on
+    // their own during rendering
+    void updateActive() noexcept
+    {
+        for (auto state : { State::held, State::sustained, State::released })
+        {
+            for (auto* node = getList(state).first; node != nullptr;)
+            {
+                auto* next = node->next;
+                update(*node);
+                node = next;
+            }
+        }
+    }
+
+    juce::SynthesiserVoice* getFreeVoice() const noexcept
+    {
+        auto* node = getList(State::free).first;
+        return node != nullptr ? &node->voice : nullptr;
+    }
+
+    // ChordialSynthesiser's stealing priorities: the oldest voice already sounding the note,
+    // else the oldest released voice, else the oldest with no key down, else the oldest
+    juce::SynthesiserVoice* getVoiceToSteal(int midiNoteNumber) const noexcept
+    {
+        const Node* node = nullptr;
+
+        if (juce::isPositiveAndBelow(midiNoteNumber, numNotes))
+            node = notes[midiNoteNumber].first;
+        if (node == nullptr)
+            node = getList(State::released).first;
+        if (node == nullptr)
+            node = getList(State::sustained).first;
+        if (node == nullptr)
+            node = getList(State::held).first;
+
+        return node != nullptr ? &node->voice : nullptr;
+    }
+
+    int getNumVoices(State state) const noexcept { return getList(state).size; }
+
+    static State classify(const juce::SynthesiserVoice& voice) noexcept
+    {
+        if (!voice.isVoiceActive())
+            return State::free;
+        if (voice.isKeyDown())
+            return State::held;
+        if (voice.isSustainPedalDown() || voice.isSostenutoPedalDown())
+            return State::sustained;
+        return State::released;
+    }
+
+private:
+    struct List
+    {
+        Node* first{ nullptr };
+        Node* last{ nullptr };
+        int size{ 0 };
+    };
+
+    static constexpr int numNotes = 128;
+
+    List& getList(State state) noexcept { return lists[static_cast<size_t>(state)]; }
+    const List& getList(State state) const noexcept { return lists[static_cast<size_t>(state)]; }
+
+    static void append(List& list, Node& node, Node* Node::* previous = &Node::previous, Node* Node::* next = &Node::next) noexcept
+    {
+        node.*previous = list.last;
+        node.*next = nullptr;
+        if (list.last != nullptr)
+            list.last->*next = &node;
+        else
+            list.first = &node;
+        list.last = &node;
+        ++list.size;
+    }
+
+    static void unlink(List& list, Node& node, Node* Node::* previous = &Node::previous, Node* Node::* next = &Node::next) noexcept
+    {
+        if (node.*previous != nullptr)
+            node.*previous->*next = node.*next;
+        else
+            list.first = node.*next;
+
+        if (node.*next != nullptr)
+            node.*next->*previous = node.*previous;
+        else
+            list.last = node.*previous;
+
+        node.*previous = nullptr;
+        node.*next = nullptr;
+        --list.size;
+    }
+
+    void unlinkNote(Node& node) noexcept
+    {
+        if (juce::isPositiveAndBelow(node.note, numNotes))
+            unlink(notes[node.note], node, &Node::previousOnNote, &Node::nextOnNote);
+        node.note = -1;
+    }
+
+    static void insertInStartOrder(List& list, Node& node) noexcept
+    {
+        auto* after = list.last;
+        while (after != nullptr && after->startOrder > node.startOrder)
+            after = after->previous;
+
+        node.previous = after;
+        node.next = after != nullptr ? after->next : list.first;
+        if (node.next != nullptr)
+            node.next->previous = &node;
+        else
+            list.last = &node;
+        if (after != nullptr)
+            after->next = &node;
+        else
+            list.first = &node;
+        ++list.size;
+    }
+
+    List lists[static_cast<size_t>(State::numStates)];
+    List notes[numNotes];
+    juce::uint32 startCounter{ 0 };
+};
+
+}
+}
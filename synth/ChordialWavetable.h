@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    ChordialWavetable.h
+
+  ==============================================================================
+*/
+
+#pragma once
+namespace chordial
+{
+namespace synth
+{
+
+/*  Band-limited single cycle tables for sine, triangle, saw and square, one mip level per
+    octave. Level l holds the harmonics up to 512 / 2^l, so played at the level getLevel()
+    picks for its increment no harmonic passes Nyquist; the top level is a pure sine. With
+    4096 samples a level's highest harmonic spans 8, where linear interpolation costs it
+    0.4 dB.
+
+    The tables are built once by getShared() and only read after that, so every voice of
+    every synth instance shares one copy (about 640 KB for float). Each is tableSize + 1
+    samples long, the last repeating the first, so lookup() never wraps its index.
+*/
+template <typename FloatType>
+class ChordialWavetable
+{
+public:
+    // Morph positions, in order
+    enum class Shape { sine, triangle, saw, square };
+
+    static constexpr int numShapes = 4;
+    static constexpr int tableBits = 12;
+    static constexpr int tableSize = 1 << tableBits;
+    static constexpr int numLevels = 10;
+    static constexpr int maxHarmonics = 512;
+
+    // Not real-time safe the first time, when it builds the tables. Oscillators take it on
+    // construction, so that happens before playback.
+    static const ChordialWavetable& getShared()
+    {
+        static const ChordialWavetable wavetable;
+        return wavetable;
+    }
+
+    // The level whose highest harmonic stays below Nyquist at an increment of a
+    // ChordialPhaseAccumulator<juce::uint32>
+    static int getLevel(juce::uint32 increment) noexcept
+    {
+        // floor(1024 * cycles per sample), whose bit count is the octave above the lowest level
+        auto octaves = increment >> (32 - 10);
+        int level = 0;
+        while (octaves != 0)
+        {
+            ++level;
+            octaves >>= 1;
+        }
+        return juce::jmin(level, numLevels - 1);
+    }
+
+    const FloatType* getTable(int shape, int level) const noexcept
+    {
+        jassert(juce::isPositiveAndBelow(shape, numShapes) && juce::isPositiveAndBelow(level, numLevels));
+        return tables.data() + static_cast<size_t>(shape * numLevels + level) * (tableSize + 1);
+    }
+
+    // Linearly interpolated at a 32-bit phase: the top bits index the table and the rest
+    // are the fraction
+    static FloatType lookup(const FloatType* table, juce::uint32 phase) noexcept
+    {
+        const auto index = phase >> (32 - tableBits);
+        const auto fraction = ChordialPhaseAccumulator<>::toNormalised<FloatType>(phase << tableBits);
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+private:
+    ChordialWavetable() : tables(static_cast<size_t>(numShapes * numLevels * (tableSize + 1)))
+    {
+        std::vector<double> sine(tableSize);
+        for (int i = 0; i < tableSize; ++i)
+            sine[i] = std::sin(juce::MathConstants<double>::twoPi * i / tableSize);
+
+        // The Fourier series of the naive waveforms in ChordialOscillatorVoice, so each
+        // morph position matches its Waveform in phase and polarity
+        const auto pi = juce::MathConstants<double>::pi;
+        std::vector<double> sum(tableSize);
+
+        for (int shape = 0; shape < numShapes; ++shape)
+        {
+            std::fill(sum.begin(), sum.end(), 0.0);
+            int harmonicsSummed = 0;
+
+            // From the top level down, adding the harmonics each level has over the one above
+            for (int level = numLevels - 1; level >= 0; --level)
+            {
+                for (int k = harmonicsSummed + 1; k <= (maxHarmonics >> level); ++k)
+                {
+                    double gain = 0.0;
+                    int offset = 0;
+
+                    switch (static_cast<Shape>(shape))
+                    {
+                    case Shape::sine:     gain = k == 1 ? 1.0 : 0.0; break;
+                    case Shape::triangle: gain = (k & 1) != 0 ? 8.0 / (pi * pi * k * k) : 0.0; offset = tableSize / 4; break;
+                    case Shape::saw:      gain = -2.0 / (pi * k); break;
+                    case Shape::square:   gain = (k & 1) != 0 ? 4.0 / (pi * k) : 0.0; break;
+                    }
+
+                    if (gain == 0.0)
+                        continue;
+
+                    for (int i = 0; i < tableSize; ++i)
+                        sum[i] += gain * sine[(k * i + offset) & (tableSize - 1)];
+                }
+
+                harmonicsSummed = maxHarmonics >> level;
+
+                auto* table = tables.data() + static_cast<size_t>(shape * numLevels + level) * (tableSize + 1);
+                for (int i = 0; i < tableSize; ++i)
+                    table[i] = static_cast<FloatType>(sum[i]);
+                table[tableSize] = table[0];
+            }
+        }
+    }
+
+    std::vector<FloatType> tables;
+};
+
+}
+}
@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Runs ChordialBenchmark and writes the results as JSON, for tracking ns/sample
+    across JUCE and compiler updates. Build as a JUCE console application with the
+    matt_chordial_synth module and its CHORDIAL_TOOLS option, in a release configuration.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#if ! CHORDIAL_TOOLS
+ #error "Enable the matt_chordial_synth module's CHORDIAL_TOOLS option to build ChordialBench"
+#endif
+
+namespace
+{
+    void printUsage()
+    {
+        std::cerr << "Usage: ChordialBench [options]" << std::endl
+                  << "  --output <file.json>  write the results here instead of to stdout" << std::endl
+                  << "  --filter <text>       only run cases whose name contains text" << std::endl
+                  << "  --rates <a,b,...>     sample rates (default 44100,96000)" << std::endl
+                  << "  --blocks <a,b,...>    module block sizes (default 32,128,512)" << std::endl
+                  << "  --rows <a,b,...>      mod matrix row counts (default 1,4,16,64)" << std::endl
+                  << "  --voices <a,b,...>    voice counts for the voice and synth cases (default 1,4,16,64,256)" << std::endl
+                  << "  --time <seconds>      minimum time per case (default 0.25)" << std::endl;
+    }
+
+    template <typename Type>
+    std::vector<Type> parseList(const juce::String& text)
+    {
+        std::vector<Type> values;
+        for (const auto& item : juce::StringArray::fromTokens(text, ",", {}))
+            if (item.trim().isNotEmpty())
+                values.push_back(static_cast<Type>(item.trim().getDoubleValue()));
+        return values;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    chordial::synth::ChordialBenchmark::Options options;
+    juce::File outputFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String argument(argv[i]);
+        if (i + 1 >= argc)
+        {
+            printUsage();
+            return 1;
+        }
+        const juce::String value(argv[++i]);
+
+        if (argument == "--output")       outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+        else if (argument == "--filter")  options.filter = value.toStdString();
+        else if (argument == "--rates")   options.sampleRates = parseList<double>(value);
+        else if (argument == "--blocks")  options.blockSizes = parseList<size_t>(value);
+        else if (argument == "--rows")    options.matrixRowCounts = parseList<int>(value);
+        else if (argument == "--voices")  options.voiceCounts = parseList<int>(value);
+        else if (argument == "--time")    options.minimumSeconds = value.getDoubleValue();
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    const auto results = chordial::synth::ChordialBenchmark::runAll(options);
+
+    for (const auto& result : results)
+        std::cerr << result.name << ": " << juce::String(result.getNanosecondsPerSample(), 2) << " ns/sample" << std::endl;
+
+    const auto json = chordial::synth::ChordialBenchmark::toJSON(results);
+
+    if (outputFile == juce::File())
+    {
+        std::cout << json << std::endl;
+    }
+    else if (!outputFile.replaceWithText(json))
+    {
+        std::cerr << "Couldn't write " << outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Runs ChordialLoadTest scenarios and prints block render times against the host
+    deadline. Build as a JUCE console application with the matt_chordial_synth module
+    and its CHORDIAL_TOOLS option, in a release configuration.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#if ! CHORDIAL_TOOLS
+ #error "Enable the matt_chordial_synth module's CHORDIAL_TOOLS option to build ChordialLoadTest"
+#endif
+
+namespace
+{
+    using chordial::synth::ChordialLoadTest;
+
+    void printUsage()
+    {
+        std::cerr << "Usage: ChordialLoadTest [options]" << std::endl
+                  << "  --scenario <name>     chords, arpeggio, pads or all (default all)" << std::endl
+                  << "  --rate <hz>           sample rate (default 48000)" << std::endl
+                  << "  --block <samples>     host buffer size (default 128)" << std::endl
+                  << "  --voices <n>          polyphony (default 32)" << std::endl
+                  << "  --threads <n>         voice render threads (default 1)" << std::endl
+                  << "  --seconds <s>         length of each scenario (default 10)" << std::endl
+                  << "  --deadline <fraction> share of the buffer period the synth may use (default 1)" << std::endl
+                  << "  --unpaced             render blocks back to back instead of on the host's schedule" << std::endl
+                  << "  --budget <max>        find the largest voice count up to max with no deadline misses" << std::endl;
+    }
+
+    void printReport(const ChordialLoadTest::Report& report)
+    {
+        std::cout << report.scenario << ", " << report.numVoices << " voices ("
+                  << juce::String(report.meanActiveVoices, 1) << " active on average), "
+                  << report.numBlocks << " blocks" << std::endl
+                  << "  deadline " << juce::String(report.deadlineMs, 3) << " ms"
+                  << ", mean " << juce::String(report.meanMs, 3)
+                  << ", p99 " << juce::String(report.p99Ms, 3)
+                  << ", p999 " << juce::String(report.p999Ms, 3)
+                  << ", worst " << juce::String(report.worstMs, 3)
+                  << " (" << juce::String(100.0 * report.getWorstLoad(), 1) << "%)"
+                  << ", " << report.deadlineMisses << " missed" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    ChordialLoadTest::Settings settings;
+    std::vector<ChordialLoadTest::Scenario> scenarios{ ChordialLoadTest::Scenario::stackedChords,
+                                                       ChordialLoadTest::Scenario::fastArpeggio,
+                                                       ChordialLoadTest::Scenario::sustainedPads };
+    int budgetMaximum = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String argument(argv[i]);
+        if (argument == "--unpaced")
+        {
+            settings.paced = false;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            printUsage();
+            return 1;
+        }
+        const juce::String value(argv[++i]);
+
+        if (argument == "--scenario")
+        {
+            if (value == "chords")         scenarios = { ChordialLoadTest::Scenario::stackedChords };
+            else if (value == "arpeggio")  scenarios = { ChordialLoadTest::Scenario::fastArpeggio };
+            else if (value == "pads")      scenarios = { ChordialLoadTest::Scenario::sustainedPads };
+            else if (value != "all")
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (argument == "--rate")      settings.sampleRate = value.getDoubleValue();
+        else if (argument == "--block")     settings.blockSize = value.getIntValue();
+        else if (argument == "--voices")    settings.numVoices = value.getIntValue();
+        else if (argument == "--threads")   settings.numRenderThreads = value.getIntValue();
+        else if (argument == "--seconds")   settings.seconds = value.getDoubleValue();
+        else if (argument == "--deadline")  settings.deadlineFraction = value.getDoubleValue();
+        else if (argument == "--budget")    budgetMaximum = value.getIntValue();
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (settings.sampleRate <= 0.0 || settings.blockSize <= 0 || settings.numVoices <= 0 || settings.seconds <= 0.0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    auto missed = false;
+
+    for (const auto scenario : scenarios)
+    {
+        if (budgetMaximum > 0)
+        {
+            const auto budget = ChordialLoadTest::findPolyphonyBudget(scenario, settings, budgetMaximum);
+            std::cout << ChordialLoadTest::getScenarioName(scenario) << ": " << budget << " voices" << std::endl;
+            continue;
+        }
+
+        const auto report = ChordialLoadTest::run(scenario, settings);
+        printReport(report);
+        missed = missed || report.deadlineMisses > 0;
+    }
+
+    return missed ? 2 : 0;
+}
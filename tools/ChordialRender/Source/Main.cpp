@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless batch renderer: MIDI files in, WAV files out, one job per MIDI file.
+    Build as a JUCE console application with the matt_chordial_synth module and its
+    CHORDIAL_TOOLS option enabled.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#if ! CHORDIAL_TOOLS
+ #error "Enable the matt_chordial_synth module's CHORDIAL_TOOLS option to build ChordialRender"
+#endif
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage: ChordialRender [options] file.mid [file.mid ...]" << std::endl
+                  << "  --preset <file.xml>   parameter state to load before rendering" << std::endl
+                  << "  --output <directory>  where to write the WAV files (default: next to each MIDI file)" << std::endl
+                  << "  --rate <hz>           sample rate (default 44100)" << std::endl
+                  << "  --block <samples>     block size (default 2048)" << std::endl
+                  << "  --voices <n>          polyphony (default 8)" << std::endl
+                  << "  --bits <16|24|32>     WAV bit depth (default 24)" << std::endl
+                  << "  --tail <seconds>      longest release tail after the last event (default 10)" << std::endl
+                  << "  --jobs <n>            files rendered in parallel (default: one per CPU)" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    chordial::synth::ChordialOfflineRenderer::Settings settings;
+    juce::File presetFile, outputDirectory;
+    juce::Array<juce::File> midiFiles;
+    auto numWorkers = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String argument(argv[i]);
+        const auto hasValue = i + 1 < argc;
+        const auto value = hasValue ? juce::String(argv[i + 1]) : juce::String();
+        const auto path = [&value] { return juce::File::getCurrentWorkingDirectory().getChildFile(value); };
+
+        if (argument.startsWith("--") && !hasValue)
+        {
+            printUsage();
+            return 1;
+        }
+
+        if (argument == "--preset")         { presetFile = path(); ++i; }
+        else if (argument == "--output")    { outputDirectory = path(); ++i; }
+        else if (argument == "--rate")      { settings.sampleRate = value.getDoubleValue(); ++i; }
+        else if (argument == "--block")     { settings.blockSize = value.getIntValue(); ++i; }
+        else if (argument == "--voices")    { settings.numVoices = value.getIntValue(); ++i; }
+        else if (argument == "--bits")      { settings.bitsPerSample = value.getIntValue(); ++i; }
+        else if (argument == "--tail")      { settings.maximumTailSeconds = value.getDoubleValue(); ++i; }
+        else if (argument == "--jobs")      { numWorkers = value.getIntValue(); ++i; }
+        else if (argument.startsWith("--")) { printUsage(); return 1; }
+        else                                midiFiles.add(juce::File::getCurrentWorkingDirectory().getChildFile(argument));
+    }
+
+    if (midiFiles.isEmpty() || settings.sampleRate <= 0.0 || settings.blockSize <= 0 || settings.numVoices <= 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (outputDirectory != juce::File() && outputDirectory.createDirectory().failed())
+    {
+        std::cerr << "Couldn't create " << outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::vector<chordial::synth::ChordialOfflineRenderer::Job> jobs;
+    for (const auto& midiFile : midiFiles)
+    {
+        const auto directory = outputDirectory != juce::File() ? outputDirectory : midiFile.getParentDirectory();
+        jobs.push_back({ midiFile, presetFile, directory.getChildFile(midiFile.getFileNameWithoutExtension() + ".wav") });
+    }
+
+    const chordial::synth::ChordialOfflineRenderer renderer(settings);
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    const auto results = renderer.renderAll(jobs, numWorkers);
+    const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    auto totalAudioSeconds = 0.0;
+    auto failures = 0;
+
+    for (const auto& result : results)
+    {
+        if (!result.succeeded)
+        {
+            std::cerr << "FAILED " << result.outputFile.getFileName() << ": " << result.errorMessage << std::endl;
+            ++failures;
+            continue;
+        }
+
+        totalAudioSeconds += result.audioSeconds;
+        std::cout << result.outputFile.getFullPathName() << ": "
+                  << juce::String(result.audioSeconds, 2) << " s in " << juce::String(result.renderSeconds, 2) << " s ("
+                  << juce::String(result.getRealtimeFactor(), 1) << "x realtime)" << std::endl;
+    }
+
+    std::cout << results.size() - static_cast<size_t>(failures) << " of " << results.size() << " files, "
+              << juce::String(totalAudioSeconds, 2) << " s of audio in " << juce::String(elapsed, 2) << " s ("
+              << juce::String(elapsed > 0.0 ? totalAudioSeconds / elapsed : 0.0, 1) << "x realtime overall)" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}